@@ -0,0 +1,35 @@
+# Branchy code: data-dependent branches on a xorshift32 sequence, about
+# 10M instructions. Exits with a checksum in a0.
+    .text
+    li      t0, 500000
+    li      a1, 2463534242
+    li      a0, 0
+loop:
+    slli    t1, a1, 13
+    xor     a1, a1, t1
+    srli    t1, a1, 17
+    xor     a1, a1, t1
+    slli    t1, a1, 5
+    xor     a1, a1, t1
+
+    andi    t1, a1, 1
+    beqz    t1, even
+    addi    a0, a0, 3
+    j       parity
+even:
+    addi    a0, a0, -1
+parity:
+    andi    t1, a1, 6
+    li      t2, 4
+    bltu    t1, t2, low
+    xor     a0, a0, a1
+low:
+    srli    t1, a1, 30
+    beqz    t1, next
+    li      t2, 2
+    blt     t1, t2, next
+    add     a0, a0, t1
+next:
+    addi    t0, t0, -1
+    bnez    t0, loop
+    ecall
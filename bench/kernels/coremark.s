@@ -0,0 +1,210 @@
+# CoreMark-style workload: per iteration a linked-list reversal and walk,
+# a 6x6 matrix multiply with shift-and-add multiplication (RV32I has no
+# MUL), a state machine over a 64-byte input and a CRC-16 of the three
+# results, about 10M instructions. Exits with the running CRC in a0.
+    .text
+    li      sp, 0x100000
+
+    # List: 32 nodes of { next, value } at 0x30000
+    li      a0, 0x30000
+    li      t0, 0
+    li      t1, 32
+list_init:
+    addi    t2, a0, 8
+    sw      t2, 0(a0)
+    xori    t3, t0, 0x15
+    sw      t3, 4(a0)
+    addi    a0, a0, 8
+    addi    t0, t0, 1
+    bltu    t0, t1, list_init
+    sw      zero, -8(a0)
+    li      s1, 0x30000             # List head
+
+    # A[i][j] = (7i + 3j + 1) & 127 at 0x31000, B[i][j] = (i + 2j + 5) & 63 at 0x31100
+    li      a0, 0x31000
+    li      a1, 0x31100
+    li      t0, 0                   # i
+matrix_row:
+    li      t1, 0                   # j
+matrix_col:
+    slli    t2, t0, 3
+    sub     t2, t2, t0
+    slli    t3, t1, 1
+    add     t3, t3, t1
+    add     t2, t2, t3
+    addi    t2, t2, 1
+    andi    t2, t2, 127
+    sw      t2, 0(a0)
+    slli    t3, t1, 1
+    add     t3, t3, t0
+    addi    t3, t3, 5
+    andi    t3, t3, 63
+    sw      t3, 0(a1)
+    addi    a0, a0, 4
+    addi    a1, a1, 4
+    addi    t1, t1, 1
+    li      t4, 6
+    bltu    t1, t4, matrix_col
+    addi    t0, t0, 1
+    bltu    t0, t4, matrix_row
+
+    # Input: 64 bytes of (37k + 11) & 127 at 0x31400
+    li      a0, 0x31400
+    li      t0, 11
+    li      t1, 64
+input_init:
+    andi    t2, t0, 127
+    sb      t2, 0(a0)
+    addi    t0, t0, 37
+    addi    a0, a0, 1
+    addi    t1, t1, -1
+    bnez    t1, input_init
+
+    li      s0, 800                 # Iterations
+    li      s2, 0                   # CRC
+iter:
+    # Reverse the list, then sum its values
+    li      t0, 0
+    mv      t1, s1
+reverse:
+    lw      t2, 0(t1)
+    sw      t0, 0(t1)
+    mv      t0, t1
+    mv      t1, t2
+    bnez    t1, reverse
+    mv      s1, t0
+    li      s3, 0
+walk:
+    lw      t2, 4(t0)
+    add     s3, s3, t2
+    slli    s3, s3, 1
+    lw      t0, 0(t0)
+    bnez    t0, walk
+    mv      a0, s3
+    mv      a1, s2
+    call    crc16
+    mv      s2, a1
+
+    # C = A x B, summed
+    li      s3, 0
+    li      s4, 0                   # i
+mm_row:
+    li      s5, 0                   # j
+mm_col:
+    li      s6, 0                   # k
+    li      s7, 0                   # Dot product
+mm_dot:
+    slli    t0, s4, 1
+    add     t0, t0, s4
+    slli    t0, t0, 1
+    add     t0, t0, s6
+    slli    t0, t0, 2               # (6i + k) * 4
+    li      t1, 0x31000
+    add     t0, t0, t1
+    lw      a0, 0(t0)
+    slli    t0, s6, 1
+    add     t0, t0, s6
+    slli    t0, t0, 1
+    add     t0, t0, s5
+    slli    t0, t0, 2               # (6k + j) * 4
+    li      t1, 0x31100
+    add     t0, t0, t1
+    lw      a1, 0(t0)
+    call    mul
+    add     s7, s7, a0
+    addi    s6, s6, 1
+    li      t0, 6
+    bltu    s6, t0, mm_dot
+    xor     s3, s3, s7
+    add     s3, s3, s7
+    addi    s5, s5, 1
+    bltu    s5, t0, mm_col
+    addi    s4, s4, 1
+    bltu    s4, t0, mm_row
+    mv      a0, s3
+    mv      a1, s2
+    call    crc16
+    mv      s2, a1
+
+    # State machine: digits, '.', ',' and anything else
+    li      t0, 0x31400
+    addi    t1, t0, 64
+    li      t2, 0                   # State
+    li      s3, 0
+scan:
+    lbu     t3, 0(t0)
+    addi    t4, t3, -48
+    li      t5, 10
+    bltu    t4, t5, digit
+    li      t5, 46
+    beq     t3, t5, point
+    li      t5, 44
+    beq     t3, t5, comma
+    li      t2, 3
+    j       scanned
+digit:
+    bnez    t2, scanned
+    li      t2, 1
+    j       scanned
+point:
+    li      t5, 1
+    beq     t2, t5, fraction
+    li      t2, 3
+    j       scanned
+fraction:
+    li      t2, 2
+    j       scanned
+comma:
+    li      t2, 0
+    addi    s3, s3, 16
+scanned:
+    add     s3, s3, t2
+    addi    t0, t0, 1
+    bltu    t0, t1, scan
+    # Vary the input between iterations
+    li      t0, 0x31400
+    andi    t1, s0, 63
+    add     t0, t0, t1
+    lbu     t2, 0(t0)
+    addi    t2, t2, 1
+    andi    t2, t2, 127
+    sb      t2, 0(t0)
+    mv      a0, s3
+    mv      a1, s2
+    call    crc16
+    mv      s2, a1
+
+    addi    s0, s0, -1
+    bnez    s0, iter
+    mv      a0, s2
+    ecall
+
+# a0 = a0 * a1 by shift and add
+mul:
+    li      t6, 0
+mul_bit:
+    andi    t5, a1, 1
+    beqz    t5, mul_skip
+    add     t6, t6, a0
+mul_skip:
+    slli    a0, a0, 1
+    srli    a1, a1, 1
+    bnez    a1, mul_bit
+    mv      a0, t6
+    ret
+
+# a1 = CRC-16 (poly 0xA001) of a1 updated with the low 16 bits of a0
+crc16:
+    li      t4, 16
+crc_bit:
+    xor     t5, a0, a1
+    andi    t5, t5, 1
+    srli    a1, a1, 1
+    beqz    t5, crc_skip
+    li      t6, 0xa001
+    xor     a1, a1, t6
+crc_skip:
+    srli    a0, a0, 1
+    addi    t4, t4, -1
+    bnez    t4, crc_bit
+    ret
@@ -0,0 +1,140 @@
+# Dhrystone-style workload: record assignment, string comparison,
+# integer arithmetic and an enumeration switch through leaf procedure
+# calls, about 10M instructions. Exits with a checksum in a0.
+    .text
+    li      sp, 0x100000
+    # Record A: twelve words
+    li      a0, 0x10000
+    li      t0, 0
+    li      t1, 12
+init:
+    slli    t2, t0, 4
+    add     t2, t2, t0
+    sw      t2, 0(a0)
+    addi    a0, a0, 4
+    addi    t0, t0, 1
+    bltu    t0, t1, init
+    # "DHRYSTONE PROGRAM, SOME STRING"
+    li      a0, 0x10100
+    li      t1, 0x59524844
+    sw      t1, 0(a0)
+    li      t1, 0x4e4f5453
+    sw      t1, 4(a0)
+    li      t1, 0x52502045
+    sw      t1, 8(a0)
+    li      t1, 0x4152474f
+    sw      t1, 12(a0)
+    li      t1, 0x53202c4d
+    sw      t1, 16(a0)
+    li      t1, 0x20454d4f
+    sw      t1, 20(a0)
+    li      t1, 0x49525453
+    sw      t1, 24(a0)
+    li      t1, 0x0000474e
+    sw      t1, 28(a0)
+    # "DHRYSTONE PROGRAM, 2'ND STRING"
+    li      a0, 0x10140
+    li      t1, 0x59524844
+    sw      t1, 0(a0)
+    li      t1, 0x4e4f5453
+    sw      t1, 4(a0)
+    li      t1, 0x52502045
+    sw      t1, 8(a0)
+    li      t1, 0x4152474f
+    sw      t1, 12(a0)
+    li      t1, 0x32202c4d
+    sw      t1, 16(a0)
+    li      t1, 0x20444e27
+    sw      t1, 20(a0)
+    li      t1, 0x49525453
+    sw      t1, 24(a0)
+    li      t1, 0x0000474e
+    sw      t1, 28(a0)
+
+    li      s0, 40000               # Iterations
+    li      s1, 0                   # Checksum
+    li      s2, 0                   # Enumeration
+iter:
+    li      a0, 0x10000
+    li      a1, 0x10040
+    call    copy_record
+    mv      a0, s0
+    call    arith
+    add     s1, s1, a0
+    li      a0, 0x10100
+    li      a1, 0x10140
+    call    strcmp
+    add     s1, s1, a0
+
+    # switch (enumeration)
+    andi    t0, s2, 3
+    beqz    t0, ident1
+    li      t1, 1
+    beq     t0, t1, ident2
+    li      t1, 2
+    beq     t0, t1, ident3
+    addi    s1, s1, -5
+    li      s2, 0
+    j       switched
+ident1:
+    addi    s1, s1, 1
+    li      s2, 2
+    j       switched
+ident2:
+    xori    s1, s1, 0x55
+    li      s2, 3
+    j       switched
+ident3:
+    slli    t1, s1, 1
+    srli    s1, s1, 1
+    xor     s1, s1, t1
+    li      s2, 1
+switched:
+    li      t1, 0x10040
+    lw      t2, 20(t1)
+    add     s1, s1, t2
+    addi    s0, s0, -1
+    bnez    s0, iter
+    mv      a0, s1
+    ecall
+
+# Copies the twelve-word record at a0 to a1
+copy_record:
+    addi    t0, a0, 48
+copy_word:
+    lw      t1, 0(a0)
+    sw      t1, 0(a1)
+    addi    a0, a0, 4
+    addi    a1, a1, 4
+    bltu    a0, t0, copy_word
+    ret
+
+# Proc_7/Proc_8 style arithmetic on a0
+arith:
+    li      t0, 2
+    li      t1, 3
+    add     t2, t0, t1
+    addi    t2, t2, 2
+    slli    t3, t1, 2
+    add     t3, t3, t1
+    sub     t3, t3, t0
+    add     t2, t2, t3
+    andi    t4, a0, 7
+    add     a0, t2, t4
+    ret
+
+# Returns 1 if the string at a0 sorts after the one at a1, else 0
+strcmp:
+    lbu     t0, 0(a0)
+    lbu     t1, 0(a1)
+    bne     t0, t1, differ
+    beqz    t0, same
+    addi    a0, a0, 1
+    addi    a1, a1, 1
+    j       strcmp
+differ:
+    sltu    a0, t1, t0
+    ret
+same:
+    li      a0, 0
+    ret
@@ -0,0 +1,19 @@
+# Integer loop: dependent ALU operations and a counted loop, about 11M
+# instructions. Exits with a checksum in a0.
+    .text
+    li      t0, 1000000
+    li      a0, 0
+    li      a1, 1
+loop:
+    add     a0, a0, a1
+    xor     a1, a1, a0
+    slli    a2, a0, 3
+    srli    a3, a1, 5
+    sub     a0, a0, a3
+    or      a1, a1, a2
+    addi    a1, a1, 7
+    andi    a2, a0, 255
+    add     a0, a0, a2
+    addi    t0, t0, -1
+    bnez    t0, loop
+    ecall
@@ -0,0 +1,43 @@
+# Block copy: 64 KiB copied 200 times with an unrolled word loop, about
+# 9M instructions. Exits with the sum of the destination words in a0.
+    .text
+    # Fill the source with a pattern
+    li      a0, 0x10000
+    li      a1, 0x20000
+    li      a2, 0x9e3779b9
+fill:
+    sw      a2, 0(a0)
+    addi    a2, a2, 0x3b
+    addi    a0, a0, 4
+    bltu    a0, a1, fill
+
+    li      t0, 200
+copy:
+    li      a0, 0x10000
+    li      a1, 0x20000
+    li      a2, 0x20000
+words:
+    lw      t1, 0(a0)
+    lw      t2, 4(a0)
+    lw      t3, 8(a0)
+    lw      t4, 12(a0)
+    sw      t1, 0(a1)
+    sw      t2, 4(a1)
+    sw      t3, 8(a1)
+    sw      t4, 12(a1)
+    addi    a0, a0, 16
+    addi    a1, a1, 16
+    bltu    a0, a2, words
+    addi    t0, t0, -1
+    bnez    t0, copy
+
+    # Checksum the copy
+    li      a0, 0
+    li      a1, 0x20000
+    li      a2, 0x30000
+sum:
+    lw      t1, 0(a1)
+    add     a0, a0, t1
+    addi    a1, a1, 4
+    bltu    a1, a2, sum
+    ecall
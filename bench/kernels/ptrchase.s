@@ -0,0 +1,33 @@
+# Pointer chase: 2M dependent loads through a 256 KiB ring of 8-byte
+# nodes visited in LCG order, about 10M instructions. Exits with the sum
+# of the visited node values in a0.
+    .text
+    li      s0, 0x40000             # Node base
+    li      s1, 32767               # Node index mask
+    # node[i] = { &node[(5 * i + 12345) & mask], i }
+    li      t0, 0
+build:
+    slli    t1, t0, 2
+    add     t1, t1, t0
+    li      t2, 12345
+    add     t1, t1, t2
+    and     t1, t1, s1
+    slli    t1, t1, 3
+    add     t1, t1, s0
+    slli    t2, t0, 3
+    add     t2, t2, s0
+    sw      t1, 0(t2)
+    sw      t0, 4(t2)
+    addi    t0, t0, 1
+    bleu    t0, s1, build
+
+    li      t0, 2000000
+    mv      a1, s0
+    li      a0, 0
+chase:
+    lw      t1, 4(a1)
+    lw      a1, 0(a1)
+    add     a0, a0, t1
+    addi    t0, t0, -1
+    bnez    t0, chase
+    ecall
@@ -0,0 +1,16 @@
+#!/bin/bash
+# Reassembles the fisc_bench guest kernels (bench/kernels/*.s) into the
+# raw RV32I images checked in beside them. Needs llvm-mc and llvm-objcopy;
+# the kernels load at address 0 and use no relocations.
+set -e
+
+MC=${LLVM_MC:-llvm-mc}
+OBJCOPY=${LLVM_OBJCOPY:-llvm-objcopy}
+KERNELS="$(dirname "$0")/../bench/kernels"
+
+for source in "$KERNELS"/*.s; do
+    object="${source%.s}.o"
+    "$MC" -triple=riscv32 -mattr=-c,-relax -filetype=obj "$source" -o "$object"
+    "$OBJCOPY" -O binary --only-section=.text "$object" "${source%.s}.bin"
+    rm -f "$object"
+done
@@ -0,0 +1,343 @@
+// fisc_bench: runs the in-tree guest kernels (bench/kernels) under every
+// execution engine and memory configuration and reports guest MIPS, host
+// nanoseconds and host cycles per guest instruction. With --baseline the
+// MIPS of each case are compared against a stored --json run, and any case
+// slower by more than --threshold percent fails the run. The checked-in
+// bench/baseline.json comes from a Release build; other hosts should
+// record their own with --json.
+#include "../config/ResolvedConfig.hpp"
+#include "../vpu/FiscVpu.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define FISC_BENCH_TSC 1
+#else
+#define FISC_BENCH_TSC 0
+#endif
+
+#ifndef FISC_BENCH_KERNELS
+#define FISC_BENCH_KERNELS "bench/kernels"
+#endif
+
+namespace {
+
+// RV32I images assembled by scripts/assemble_kernels.sh; each exits
+// through ECALL with a checksum in a0
+const char* const KERNELS[] = {"intloop", "memcpy", "ptrchase", "branchy", "dhrystone", "coremark"};
+
+struct MemoryConfig {
+    const char* name;
+    const char* param;  // Null keeps the defaults
+    const char* value;
+};
+const MemoryConfig MEMORY_CONFIGS[] = {
+    {"flat", nullptr, nullptr},
+    {"hugepages", "HUGE_PAGES", "true"},
+    {"cached", "CACHE_SIMULATION", "true"},
+};
+
+struct Options {
+    std::string kernels = FISC_BENCH_KERNELS;
+    unsigned warmup = 1;
+    unsigned repetitions = 5;
+    std::string kernel, engine, memory;  // Filters; empty runs all
+    std::string json;
+    std::string baseline;
+    double threshold = 15;  // Percent
+};
+
+struct Result {
+    std::string kernel, engine, memory;
+    uint64_t instructions;
+    double mips;
+    double nsPerInstruction;
+    double cyclesPerInstruction;  // 0 without a cycle counter
+};
+
+// TSC ticks count at the nominal clock rather than the current one
+uint64_t hostCycles() {
+#if FISC_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+void printUsage() {
+    std::cout << "Usage: fisc_bench [options]\n"
+              << "  --kernels <dir>      Kernel images (default " FISC_BENCH_KERNELS ")\n"
+              << "  --warmup <n>         Unmeasured runs per case (default 1)\n"
+              << "  --reps <n>           Measured runs per case; the fastest is reported (default 5)\n"
+              << "  --kernel <name>      Only this kernel\n"
+              << "  --engine <name>      Only this EXECUTION_ENGINE\n"
+              << "  --memory <name>      Only this memory configuration (flat, hugepages, cached)\n"
+              << "  --json <file>        Write the results as JSON\n"
+              << "  --baseline <file>    Compare MIPS against a --json file; regressions exit 1\n"
+              << "  --threshold <pct>    Allowed slowdown against the baseline (default 15)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--kernels") {
+                options.kernels = value;
+            } else if (arg == "--warmup") {
+                options.warmup = static_cast<unsigned>(std::stoul(value));
+            } else if (arg == "--reps") {
+                options.repetitions = static_cast<unsigned>(std::stoul(value));
+            } else if (arg == "--kernel") {
+                options.kernel = value;
+            } else if (arg == "--engine") {
+                options.engine = value;
+            } else if (arg == "--memory") {
+                options.memory = value;
+            } else if (arg == "--json") {
+                options.json = value;
+            } else if (arg == "--baseline") {
+                options.baseline = value;
+            } else if (arg == "--threshold") {
+                options.threshold = std::stod(value);
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return options.repetitions > 0;
+}
+
+// One measured run: execution only, after initialize() has loaded the image
+struct Sample {
+    uint64_t instructions;
+    int exitStatus;
+    double seconds;
+    uint64_t cycles;
+};
+
+bool runKernel(const std::shared_ptr<const ResolvedConfig>& config, Sample& sample, std::string& error) {
+    FiscVpu vpu(config);
+    vpu.setOutputCallback([&error](const std::string& message) { error = message; });
+    if (!vpu.initialize()) {
+        return false;
+    }
+    // Kernels print nothing worth keeping while they run
+    vpu.setOutputCallback(nullptr);
+    vpu.beginScheduledRun();
+    const auto start = FiscVpu::Clock::now();
+    const uint64_t startCycles = hostCycles();
+    while (vpu.isRunning()) {
+        vpu.runSlice();
+    }
+    sample.cycles = hostCycles() - startCycles;
+    sample.seconds = std::chrono::duration<double>(FiscVpu::Clock::now() - start).count();
+    sample.instructions = vpu.getExecutionStats().instructions;
+    sample.exitStatus = vpu.getExitStatus();
+    if (vpu.getGuestExit() != FiscVpu::GuestExit::Exited) {
+        error = "did not exit through ECALL";
+        return false;
+    }
+    return true;
+}
+
+// Reads back the one-result-per-line format writeJson() produces
+std::string field(const std::string& line, const std::string& key) {
+    const std::string pattern = "\"" + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += pattern.size();
+    if (line[pos] == '"') {
+        return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+    }
+    return line.substr(pos, line.find_first_of(",}", pos) - pos);
+}
+
+std::string caseName(const std::string& kernel, const std::string& engine, const std::string& memory) {
+    return kernel + "/" + engine + "/" + memory;
+}
+
+bool readBaseline(const std::string& path, std::map<std::string, double>& mips) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string kernel = field(line, "kernel");
+        std::string value = field(line, "mips");
+        if (!kernel.empty() && !value.empty()) {
+            mips[caseName(kernel, field(line, "engine"), field(line, "memory"))] = std::stod(value);
+        }
+    }
+    return true;
+}
+
+bool writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "{\"results\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        char line[320];
+        std::snprintf(line, sizeof(line),
+                      "  {\"kernel\":\"%s\",\"engine\":\"%s\",\"memory\":\"%s\",\"instructions\":%llu,"
+                      "\"mips\":%.3f,\"ns_per_insn\":%.4f,\"cycles_per_insn\":%.4f}%s\n",
+                      r.kernel.c_str(), r.engine.c_str(), r.memory.c_str(),
+                      static_cast<unsigned long long>(r.instructions), r.mips, r.nsPerInstruction,
+                      r.cyclesPerInstruction, i + 1 < results.size() ? "," : "");
+        file << line;
+    }
+    file << "]}\n";
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<ResolvedConfig::LineError> errors;
+    uint32_t lines[CONFIG_PARAM_COUNT];
+    std::shared_ptr<const ResolvedConfig> base = ResolvedConfig::parse(
+        "ARCHITECTURE = RISC-V-32\n"
+        "MEMORY_SIZE = 1048576\n"
+        "CPU_THROTTLE = false\n"
+        "QUANTUM_SIZE = 100000\n",
+        errors, lines);
+    if (!base) {
+        std::cerr << errors.front().message << "\n";
+        return 1;
+    }
+
+    const auto& engines = FiscConfigSchema::get(ConfigParam::EXECUTION_ENGINE);
+    std::vector<Result> results;
+    bool failed = false;
+    for (const char* kernel : KERNELS) {
+        if (!options.kernel.empty() && options.kernel != kernel) {
+            continue;
+        }
+        // Every case of a kernel must retire the same instructions and
+        // reach the same checksum as the first one
+        std::string referenceName;
+        Sample reference{};
+        for (size_t e = 0; e < engines.enumCount; ++e) {
+            const std::string engine(engines.enumValues[e]);
+            if (!options.engine.empty() && options.engine != engine) {
+                continue;
+            }
+            for (const auto& memory : MEMORY_CONFIGS) {
+                if (!options.memory.empty() && options.memory != memory.name) {
+                    continue;
+                }
+                std::string error;
+                auto config = base->withParameter(ConfigParam::EXECUTION_ENGINE, engine, error);
+                if (config) {
+                    config = config->withParameter(ConfigParam::PROGRAM_IMAGE,
+                                                   options.kernels + "/" + kernel + ".bin", error);
+                }
+                ConfigParam param;
+                if (config && memory.param && ResolvedConfig::lookup(memory.param, param)) {
+                    config = config->withParameter(param, memory.value, error);
+                }
+                if (!config) {
+                    std::cerr << error << "\n";
+                    return 1;
+                }
+
+                const std::string name = caseName(kernel, engine, memory.name);
+                std::vector<Sample> samples(options.warmup + options.repetitions);
+                bool ok = true;
+                for (auto& sample : samples) {
+                    ok = ok && runKernel(config, sample, error);
+                }
+                if (ok && referenceName.empty()) {
+                    reference = samples.front();
+                    referenceName = name;
+                }
+                if (ok && (samples.front().instructions != reference.instructions ||
+                           samples.front().exitStatus != reference.exitStatus)) {
+                    error = "result differs from " + referenceName;
+                    ok = false;
+                }
+                if (!ok) {
+                    std::printf("%-36s FAILED: %s\n", name.c_str(), error.c_str());
+                    failed = true;
+                    continue;
+                }
+
+                // The fastest measured run: host interference only ever slows a run down
+                const Sample& best = *std::min_element(
+                    samples.begin() + options.warmup, samples.end(),
+                    [](const Sample& a, const Sample& b) { return a.seconds < b.seconds; });
+                const double instructions = static_cast<double>(best.instructions);
+                results.push_back({kernel, engine, memory.name, best.instructions,
+                                   instructions / best.seconds / 1e6,
+                                   best.seconds * 1e9 / instructions,
+                                   best.cycles / instructions});
+                const Result& r = results.back();
+                std::printf("%-36s %9.1f MIPS %8.2f ns/insn", name.c_str(), r.mips, r.nsPerInstruction);
+                if (FISC_BENCH_TSC) {
+                    std::printf(" %8.2f cycles/insn", r.cyclesPerInstruction);
+                }
+                std::printf("\n");
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    if (!options.json.empty() && !writeJson(options.json, results)) {
+        std::cerr << "cannot write " << options.json << "\n";
+        return 1;
+    }
+
+    if (!options.baseline.empty()) {
+        std::map<std::string, double> baseline;
+        if (!readBaseline(options.baseline, baseline)) {
+            std::cerr << "cannot read " << options.baseline << "\n";
+            return 1;
+        }
+        size_t compared = 0, regressions = 0;
+        for (const auto& r : results) {
+            auto it = baseline.find(caseName(r.kernel, r.engine, r.memory));
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            ++compared;
+            const double change = 100.0 * (r.mips / it->second - 1);
+            if (change < -options.threshold) {
+                ++regressions;
+                std::printf("REGRESSION %s: %.1f MIPS against %.1f (%.1f %%)\n",
+                            caseName(r.kernel, r.engine, r.memory).c_str(), r.mips, it->second, change);
+            }
+        }
+        std::printf("%zu cases compared with %s, %zu regressed by more than %.1f %%\n",
+                    compared, options.baseline.c_str(), regressions, options.threshold);
+        failed = failed || regressions > 0;
+    }
+    return failed ? 1 : 0;
+}
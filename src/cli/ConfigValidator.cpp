@@ -0,0 +1,193 @@
+#include "ConfigValidator.hpp"
+#include "../config/ResolvedConfig.hpp"
+#include "../vpu/FiscVpu.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FISC_VALIDATOR_MMAP 1
+#else
+#define FISC_VALIDATOR_MMAP 0
+#endif
+
+namespace {
+
+// Read-only view of a whole configuration file
+class ConfigFile {
+public:
+    ~ConfigFile() {
+#if FISC_VALIDATOR_MMAP
+        if (view && view != MAP_FAILED) {
+            munmap(view, length);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool open(const std::string& path) {
+#if FISC_VALIDATOR_MMAP
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            return true;
+        }
+        view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        chars = static_cast<const char*>(view);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        chars = buffer.data();
+        length = buffer.size();
+        return true;
+#endif
+    }
+
+    std::string_view text() const { return std::string_view(chars, length); }
+
+private:
+    int fd = -1;
+    void* view = nullptr;
+    const char* chars = nullptr;
+    size_t length = 0;
+    std::vector<char> buffer;
+};
+
+void expandTarget(const std::string& target, std::vector<std::string>& files) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(target, ec)) {
+        std::vector<std::string> found;
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(target, options, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) {
+                break;
+            }
+            if (it->path().extension() == ".fxml" && it->is_regular_file(ec)) {
+                found.push_back(it->path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+        return;
+    }
+#if FISC_VALIDATOR_MMAP
+    if (target.find_first_of("*?[") != std::string::npos) {
+        glob_t matches;
+        if (glob(target.c_str(), 0, nullptr, &matches) == 0) {
+            files.insert(files.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+        }
+        globfree(&matches);
+        return;
+    }
+#endif
+    files.push_back(target);
+}
+
+// Schema errors per line, then the cross-parameter rules on a clean file
+void validateFile(const std::string& path, std::vector<ResolvedConfig::LineError>& errors) {
+    ConfigFile file;
+    if (!file.open(path)) {
+        errors.push_back({0, "cannot read file"});
+        return;
+    }
+    uint32_t lines[CONFIG_PARAM_COUNT];
+    auto config = ResolvedConfig::parse(file.text(), errors, lines);
+    if (!config) {
+        return;
+    }
+    ConfigParam param;
+    std::string reason;
+    if (!FiscVpu::checkConfig(*config, param, reason)) {
+        errors.push_back({lines[static_cast<size_t>(param)],
+                          std::string(ResolvedConfig::name(param)) + ": " + reason});
+    }
+}
+
+} // namespace
+
+int validateConfigs(const std::vector<std::string>& targets, std::ostream& out) {
+    std::vector<std::string> expanded;
+    for (const auto& target : targets) {
+        expandTarget(target, expanded);
+    }
+    // Overlapping targets (a.fxml '*.fxml', dir dir/sub) name a file once,
+    // in the order it was first given
+    std::vector<std::string> files;
+    std::set<std::filesystem::path> seen;
+    for (auto& path : expanded) {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(path, ec);
+        if (seen.insert(ec ? std::filesystem::path(path) : canonical).second) {
+            files.push_back(std::move(path));
+        }
+    }
+    if (files.empty()) {
+        out << "No configuration files found\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<ResolvedConfig::LineError>> reports(files.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            validateFile(files[i], reports[i]);
+        }
+    };
+    const size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), files.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t invalid = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (reports[i].empty()) {
+            continue;
+        }
+        ++invalid;
+        for (const auto& error : reports[i]) {
+            out << files[i];
+            if (error.line) {
+                out << ":" << error.line;
+            }
+            out << ": " << error.message << "\n";
+        }
+    }
+
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "%zu files, %zu invalid, %.3f s on %zu threads (%.0f files/s)\n",
+                  files.size(), invalid, seconds, threadCount, seconds > 0 ? files.size() / seconds : 0.0);
+    out << summary;
+    return invalid ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#ifndef CONFIG_VALIDATOR_HPP
+#define CONFIG_VALIDATOR_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Batch check of .fxml files for `fisc_cli validate`. Targets are files,
+// directories (searched recursively for *.fxml) or glob patterns. Files
+// are checked in parallel against the schema and the VPU's
+// cross-parameter rules; every problem is reported as path:line: message,
+// followed by a throughput summary. Returns the process exit code.
+int validateConfigs(const std::vector<std::string>& targets, std::ostream& out);
+
+#endif // CONFIG_VALIDATOR_HPP
@@ -0,0 +1,193 @@
+#include "HeadlessRun.hpp"
+#include "../config/ResolvedConfig.hpp"
+#include "../vpu/FiscVpu.hpp"
+#include "../vpu/VpuPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define FISC_HEADLESS_RUSAGE 1
+#else
+#define FISC_HEADLESS_RUSAGE 0
+#endif
+
+namespace {
+
+// Peak resident set of the whole process in bytes; 0 where unavailable
+uint64_t peakResidentBytes() {
+#if FISC_HEADLESS_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+const char* outcomeName(FiscVpu::GuestExit exit, bool limited) {
+    if (limited) {
+        return "limit";
+    }
+    switch (exit) {
+        case FiscVpu::GuestExit::Exited:
+            return "exited";
+        case FiscVpu::GuestExit::Trapped:
+            return "trapped";
+        default:
+            return "halted";
+    }
+}
+
+int exitStatus(const FiscVpu& vpu, bool limited) {
+    if (limited) {
+        return HEADLESS_LIMIT_REACHED;
+    }
+    if (vpu.getGuestExit() == FiscVpu::GuestExit::Exited) {
+        return vpu.getExitStatus() & 0xff;
+    }
+    if (vpu.getGuestExit() == FiscVpu::GuestExit::Trapped) {
+        return HEADLESS_GUEST_TRAPPED;
+    }
+    return 0;
+}
+
+} // namespace
+
+int runHeadless(const HeadlessOptions& options, std::ostream& out) {
+    std::string error;
+    auto config = ResolvedConfig::load(options.config, error);
+    if (config && !options.image.empty()) {
+        config = config->withParameter(ConfigParam::PROGRAM_IMAGE, options.image, error);
+    }
+    if (!config) {
+        std::cerr << options.config << ": " << error << "\n";
+        return HEADLESS_RUN_FAILED;
+    }
+
+    // Output is written on this thread as the guest produces it; only the
+    // guest console goes to out, so it can be captured apart from VPU status
+    FiscVpu vpu(std::move(config));
+    vpu.setConsoleCallback([&out](const std::string& line) { out << line << std::endl; });
+    vpu.setOutputCallback([](const std::string& line) { std::cerr << line << std::endl; });
+    if (!vpu.initialize() || !vpu.beginScheduledRun()) {
+        return HEADLESS_RUN_FAILED;
+    }
+
+    using Clock = FiscVpu::Clock;
+    const auto start = Clock::now();
+    auto deadline = Clock::time_point::max();
+    if (options.timeoutSeconds > 0) {
+        deadline = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.timeoutSeconds));
+    }
+    bool limited = false;
+    while (vpu.isRunning()) {
+        // The last slice is cut short so the run stops exactly at --max-insns
+        uint64_t budget = UINT64_MAX;
+        if (options.maxInstructions) {
+            budget = options.maxInstructions - std::min(options.maxInstructions,
+                                                        vpu.getExecutionStats().instructions);
+        }
+        auto resumeAt = vpu.runSlice(budget);
+        if (!vpu.isRunning()) {
+            break;
+        }
+        if ((options.maxInstructions && vpu.getExecutionStats().instructions >= options.maxInstructions) ||
+            Clock::now() >= deadline) {
+            limited = true;
+            vpu.stop();
+            break;
+        }
+        if (resumeAt > Clock::now()) {
+            std::this_thread::sleep_until(std::min(resumeAt, deadline));
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const int status = exitStatus(vpu, limited);
+
+    if (!options.statsJson.empty()) {
+        const uint64_t instructions = vpu.getExecutionStats().instructions;
+        char json[320];
+        std::snprintf(json, sizeof(json),
+                      "{\"instructions\":%llu,\"wall_seconds\":%.6f,\"mips\":%.3f,\"peak_rss_bytes\":%llu,"
+                      "\"outcome\":\"%s\",\"exit_code\":%d}\n",
+                      static_cast<unsigned long long>(instructions), seconds,
+                      seconds > 0 ? instructions / seconds / 1e6 : 0.0,
+                      static_cast<unsigned long long>(peakResidentBytes()),
+                      outcomeName(vpu.getGuestExit(), limited), status);
+        std::ofstream file(options.statsJson, std::ios::trunc);
+        if (!file.is_open() || !(file << json)) {
+            std::cerr << "cannot write " << options.statsJson << "\n";
+            return HEADLESS_RUN_FAILED;
+        }
+    }
+    return status;
+}
+
+int runHeadlessBatch(const std::vector<std::string>& configs, size_t workers, std::ostream& out) {
+    // Workers emit concurrently; whole lines are kept together
+    std::mutex outMutex;
+    std::vector<std::shared_ptr<FiscVpu>> vpus(configs.size());
+    std::vector<VpuPool::VpuId> ids(configs.size());
+    std::vector<int> statuses(configs.size(), 0);
+    
+    VpuPool pool(workers);
+    for (size_t i = 0; i < configs.size(); ++i) {
+        std::string error;
+        auto config = ResolvedConfig::load(configs[i], error);
+        if (!config) {
+            std::cerr << configs[i] << ": " << error << "\n";
+            statuses[i] = HEADLESS_RUN_FAILED;
+            continue;
+        }
+        auto vpu = std::make_shared<FiscVpu>(std::move(config));
+        const std::string& name = configs[i];
+        vpu->setConsoleCallback([&out, &outMutex, name](const std::string& line) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << name << ": " << line << std::endl;
+        });
+        vpu->setOutputCallback([&outMutex, name](const std::string& line) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            std::cerr << name << ": " << line << std::endl;
+        });
+        if (!vpu->initialize()) {
+            statuses[i] = HEADLESS_RUN_FAILED;
+            continue;
+        }
+        vpus[i] = vpu;
+        ids[i] = pool.submit(std::move(vpu));
+    }
+    pool.waitIdle();
+    
+    int status = 0;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        if (vpus[i]) {
+            const auto accounting = pool.getAccounting(ids[i]);
+            statuses[i] = exitStatus(*vpus[i], false);
+            char line[160];
+            std::snprintf(line, sizeof(line), "%s, %llu instructions in %llu quanta, %.3f s of worker time",
+                          outcomeName(vpus[i]->getGuestExit(), false),
+                          static_cast<unsigned long long>(accounting.instructions),
+                          static_cast<unsigned long long>(accounting.quanta),
+                          accounting.cpuNanoseconds / 1e9);
+            out << configs[i] << ": " << line << "\n";
+        }
+        if (!status) {
+            status = statuses[i];
+        }
+    }
+    return status;
+}
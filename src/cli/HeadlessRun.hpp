@@ -0,0 +1,36 @@
+#ifndef HEADLESS_RUN_HPP
+#define HEADLESS_RUN_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// `fisc_cli run <config> --image ...`: one VPU run to completion with no
+// prompts, for job schedulers
+struct HeadlessOptions {
+    std::string config;     // .fxml or .fxmlc
+    std::string image;      // Overrides PROGRAM_IMAGE when set
+    uint64_t maxInstructions = 0;  // 0 is unlimited; the run stops exactly there
+    double timeoutSeconds = 0;     // 0 is unlimited
+    std::string statsJson;  // Written after the run when set
+};
+
+// Exit statuses of a run the guest did not end with its own status
+constexpr int HEADLESS_LIMIT_REACHED = 124;  // --max-insns or --timeout
+constexpr int HEADLESS_RUN_FAILED = 125;     // Configuration, image or stats file
+constexpr int HEADLESS_GUEST_TRAPPED = 126;
+
+// Streams the guest console to out and VPU messages to stderr as they are
+// produced, and returns the process exit status: the guest's own exit code
+// (0 when it halted) or one of the above
+int runHeadless(const HeadlessOptions& options, std::ostream& out);
+
+// `fisc_cli batch <config>...`: every configuration runs to completion side
+// by side on a VpuPool of workers threads (0 is one per hardware thread).
+// Output is split as in runHeadless(), with lines prefixed by their
+// configuration; a summary per VPU follows on out. Returns the first
+// non-zero status in argument order.
+int runHeadlessBatch(const std::vector<std::string>& configs, size_t workers, std::ostream& out);
+
+#endif // HEADLESS_RUN_HPP
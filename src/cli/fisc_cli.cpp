@@ -1,18 +1,158 @@
 #include "../config/FiscConfigParser.hpp"
+#include "../config/ResolvedConfig.hpp"
 #include "../shell/MiniBiosShell.hpp"
+#include "ConfigValidator.hpp"
+#include "HeadlessRun.hpp"
+#include <filesystem>
 #include <iostream>
 #include <string>
+#include <vector>
 
 void printUsage() {
     std::cout << "Usage:\n"
               << "  load <filename>                        - Load and display configuration\n"
               << "  edit <filename> <parameter> <value>    - Edit parameter in configuration\n"
               << "  save <filename>                        - Save configuration\n"
-              << "  run <filename>                         - Run VPU with configuration\n"
-              << "  exit                                   - Exit the program\n";
+              << "  run <filename> [image]                 - Run VPU with configuration and optional program image\n"
+              << "  exit                                   - Exit the program\n"
+              << "\nNon-interactive:\n"
+              << "  fisc_cli validate <dir|file|glob>...   - Check configuration files and exit\n"
+              << "  fisc_cli compile <file.fxml> [-o out]  - Write a precompiled .fxmlc configuration\n"
+              << "  fisc_cli run <config> [--image file] [--max-insns N] [--timeout S] [--stats-json out.json]\n"
+              << "                                         - Run to completion, guest console on stdout;\n"
+              << "                                           exits with the guest's code, 124 at a limit,\n"
+              << "                                           125 if the run cannot start, 126 on a guest trap\n"
+              << "  fisc_cli batch <config>... [--workers N]\n"
+              << "                                         - Run several configurations side by side on N worker\n"
+              << "                                           threads (default one per CPU) and summarize each;\n"
+              << "                                           exits with the first non-zero status of a run\n";
+}
+
+int runConfig(int argc, char* argv[]) {
+    HeadlessOptions options;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (i + 1 < argc && arg == "--image") {
+            options.image = argv[++i];
+        } else if (i + 1 < argc && arg == "--stats-json") {
+            options.statsJson = argv[++i];
+        } else if (i + 1 < argc && (arg == "--max-insns" || arg == "--timeout")) {
+            try {
+                size_t used;
+                std::string number = argv[++i];
+                if (arg == "--max-insns") {
+                    options.maxInstructions = std::stoull(number, &used, 0);
+                } else {
+                    options.timeoutSeconds = std::stod(number, &used);
+                }
+                valid = used == number.size() && number[0] != '-';
+            } catch (...) {
+                valid = false;
+            }
+        } else if (options.config.empty() && arg[0] != '-') {
+            options.config = arg;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            printUsage();
+            return HEADLESS_RUN_FAILED;
+        }
+    }
+    if (options.config.empty()) {
+        printUsage();
+        return HEADLESS_RUN_FAILED;
+    }
+    return runHeadless(options, std::cout);
+}
+
+int runBatch(int argc, char* argv[]) {
+    std::vector<std::string> configs;
+    size_t workers = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (i + 1 < argc && arg == "--workers") {
+            try {
+                size_t used;
+                std::string number = argv[++i];
+                workers = std::stoul(number, &used);
+                valid = used == number.size() && number[0] != '-';
+            } catch (...) {
+                valid = false;
+            }
+        } else if (arg[0] != '-') {
+            configs.push_back(arg);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            printUsage();
+            return HEADLESS_RUN_FAILED;
+        }
+    }
+    if (configs.empty()) {
+        printUsage();
+        return HEADLESS_RUN_FAILED;
+    }
+    return runHeadlessBatch(configs, workers, std::cout);
+}
+
+// Checked like `validate`, so a compiled configuration is one the VPU accepts
+int compileConfig(int argc, char* argv[]) {
+    std::string input, output;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (input.empty()) {
+            input = arg;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (output.empty()) {
+        output = std::filesystem::path(input).replace_extension(".fxmlc").string();
+    }
+    
+    std::string error;
+    auto config = ResolvedConfig::load(input, error);
+    ConfigParam param;
+    if (config && !FiscVpu::checkConfig(*config, param, error)) {
+        error = std::string(ResolvedConfig::name(param)) + ": " + error;
+        config = nullptr;
+    }
+    if (!config || !config->saveCompiled(output, error)) {
+        std::cerr << input << ": " << error << "\n";
+        return 1;
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "validate") {
+        if (argc == 2) {
+            printUsage();
+            return 1;
+        }
+        return validateConfigs(std::vector<std::string>(argv + 2, argv + argc), std::cout);
+    }
+    if (argc > 1 && std::string(argv[1]) == "compile") {
+        return compileConfig(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "run") {
+        return runConfig(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "batch") {
+        return runBatch(argc, argv);
+    }
+    
     FiscConfigParser parser;
     std::string command, filename, param, value;
 
@@ -27,13 +167,23 @@ int main(int argc, char* argv[]) {
             break;
         }
         else if (command == "run") {
+            std::string image;
             std::cin >> filename;
-            if (parser.loadConfig(filename)) {
+            std::getline(std::cin, image);
+            image.erase(0, image.find_first_not_of(" \t"));
+            image.erase(image.find_last_not_of(" \t") + 1);
+            // Text or compiled configurations
+            std::string error;
+            auto config = ResolvedConfig::load(filename, error);
+            if (config && !image.empty()) {
+                config = config->withParameter(ConfigParam::PROGRAM_IMAGE, image, error);
+            }
+            if (config) {
                 std::cout << "Starting MiniBIOS shell...\n";
-                MiniBiosShell shell(parser);
+                MiniBiosShell shell(std::move(config));
                 shell.run();
             } else {
-                std::cout << "Error loading configuration.\n";
+                std::cout << "Error loading configuration." << (error.empty() ? "" : " " + error) << "\n";
             }
         }
         else if (command == "load") {
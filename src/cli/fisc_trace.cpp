@@ -0,0 +1,159 @@
+#include "../vpu/InstructionTrace.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef FISC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Offline decoder for TRACE_INSTRUCTIONS output. Plain and gzip traces are
+// both accepted; gzip needs a zlib build.
+
+namespace {
+
+class TraceInput {
+public:
+    ~TraceInput() {
+#ifdef FISC_HAVE_ZLIB
+        if (gz) {
+            gzclose(gz);
+        }
+#endif
+        if (file) {
+            std::fclose(file);
+        }
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifdef FISC_HAVE_ZLIB
+        // gzread passes uncompressed files through unchanged
+        gz = gzopen(path.c_str(), "rb");
+        if (!gz) {
+            error = "cannot open " + path;
+            return false;
+        }
+#else
+        file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            error = "cannot open " + path;
+            return false;
+        }
+        int first = std::fgetc(file);
+        int second = std::fgetc(file);
+        if (first == 0x1f && second == 0x8b) {
+            error = path + " is compressed and this build has no zlib";
+            return false;
+        }
+        std::rewind(file);
+#endif
+        return true;
+    }
+
+    bool read(void* data, size_t size) {
+#ifdef FISC_HAVE_ZLIB
+        return gzread(gz, data, static_cast<unsigned>(size)) == static_cast<int>(size);
+#else
+        return std::fread(data, 1, size, file) == size;
+#endif
+    }
+
+private:
+    std::FILE* file = nullptr;
+#ifdef FISC_HAVE_ZLIB
+    gzFile gz = nullptr;
+#endif
+};
+
+const char* mnemonic(uint32_t raw) {
+    static const char* loads[8] = {"lb", "lh", "lw", "?", "lbu", "lhu", "?", "?"};
+    static const char* stores[8] = {"sb", "sh", "sw", "?", "?", "?", "?", "?"};
+    static const char* branches[8] = {"beq", "bne", "?", "?", "blt", "bge", "bltu", "bgeu"};
+    static const char* aluImm[8] = {"addi", "slli", "slti", "sltiu", "xori", "srli", "ori", "andi"};
+    static const char* alu[8] = {"add", "sll", "slt", "sltu", "xor", "srl", "or", "and"};
+
+    uint32_t funct3 = (raw >> 12) & 0x7;
+    bool alternate = (raw >> 30) & 1;
+    switch (raw & 0x7f) {
+        case 0x37: return "lui";
+        case 0x17: return "auipc";
+        case 0x6f: return "jal";
+        case 0x67: return "jalr";
+        case 0x63: return branches[funct3];
+        case 0x03: return loads[funct3];
+        case 0x23: return stores[funct3];
+        case 0x13: return funct3 == 5 && alternate ? "srai" : aluImm[funct3];
+        case 0x33:
+            if (alternate) {
+                return funct3 == 0 ? "sub" : funct3 == 5 ? "sra" : "?";
+            }
+            return alu[funct3];
+        case 0x0f: return "fence";
+        case 0x73: return raw == 0x00100073 ? "ebreak" : raw == 0x00000073 ? "ecall" : "system";
+        default: return "?";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t limit = ~0ull;
+    bool valid = argc == 2 || argc == 3;
+    if (argc == 3) {
+        try {
+            size_t used;
+            std::string number = argv[2];
+            limit = std::stoull(number, &used, 0);
+            valid = used == number.size() && number[0] != '-';
+        } catch (...) {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        std::cerr << "Usage: fisc_trace <trace file> [max records]\n";
+        return 1;
+    }
+
+    TraceInput input;
+    std::string error;
+    if (!input.open(argv[1], error)) {
+        std::cerr << "fisc_trace: " << error << "\n";
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (!input.read(&header, sizeof(header)) ||
+        std::memcmp(header.magic, "FISCTRC1", sizeof(header.magic)) != 0 ||
+        header.recordSize != sizeof(TraceRecord)) {
+        std::cerr << "fisc_trace: " << argv[1] << " is not a FISC instruction trace\n";
+        return 1;
+    }
+
+    TraceRecord record;
+    uint64_t count = 0;
+    char line[128];
+    while (count < limit && input.read(&record, sizeof(record))) {
+        int length = std::snprintf(line, sizeof(line), "%08x: %08x  %-7s",
+                                   record.pc, record.instruction, mnemonic(record.instruction));
+        if (record.rd) {
+            length += std::snprintf(line + length, sizeof(line) - length, " x%-2u = 0x%08x",
+                                    record.rd, record.rdValue);
+        }
+        if (record.memSize) {
+            length += std::snprintf(line + length, sizeof(line) - length, "  [%s %u @ 0x%08x]",
+                                    (record.flags & TRACE_STORE) ? "store" : "load",
+                                    record.memSize, record.memAddress);
+        }
+        if (record.flags & TRACE_TRAP) {
+            length += std::snprintf(line + length, sizeof(line) - length, "  <trap>");
+        }
+        while (length > 0 && line[length - 1] == ' ') {
+            --length;
+        }
+        std::cout.write(line, length) << "\n";
+        ++count;
+    }
+    std::cerr << count << " records\n";
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "ResolvedConfig.hpp"
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FISC_CONFIG_POSIX_IO 1
+#else
+#define FISC_CONFIG_POSIX_IO 0
+#endif
+
+namespace {
+
+// Values are stored in host byte order, like instruction traces
+struct CompiledHeader {
+    char magic[8];        // "FISCCFG1"
+    uint32_t version;     // COMPILED_VERSION
+    uint32_t paramCount;  // CONFIG_PARAM_COUNT
+    uint64_t schemaHash;  // FiscConfigSchema::hash()
+};
+// Followed by uint64_t values[paramCount], then a uint32_t length and the
+// text of each value in schema order, then the CRC-32 of all of it
+
+constexpr uint32_t COMPILED_VERSION = 1;
+constexpr std::string_view COMPILED_EXTENSION = ".fxmlc";
+
+// CRC-32 (IEEE), eight bytes per step: tables[k] advances a byte k
+// positions further through the register
+struct Crc32Tables {
+    uint32_t tables[8][256];
+};
+
+constexpr Crc32Tables buildCrc32Tables() {
+    Crc32Tables crc{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value >> 1) ^ (value & 1 ? 0xedb88320u : 0);
+        }
+        crc.tables[0][i] = value;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int k = 1; k < 8; ++k) {
+            uint32_t previous = crc.tables[k - 1][i];
+            crc.tables[k][i] = (previous >> 8) ^ crc.tables[0][previous & 0xff];
+        }
+    }
+    return crc;
+}
+
+constexpr Crc32Tables CRC32 = buildCrc32Tables();
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = ~0u;
+    const auto& t = CRC32.tables;
+    for (; size >= 8; data += 8, size -= 8) {
+        // Assembled little-endian; compilers fold this into one load
+        uint32_t low = data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24;
+        uint32_t high = data[4] | data[5] << 8 | data[6] << 16 | static_cast<uint32_t>(data[7]) << 24;
+        low ^= crc;
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+    for (; size; ++data, --size) {
+        crc = t[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Configurations are small; one read of the whole file beats a mapping
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+#if FISC_CONFIG_POSIX_IO
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    bytes.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = ::read(fd, bytes.data() + done, bytes.size() - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    return done == bytes.size();
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    bytes.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()));
+#endif
+}
+
+bool isCompiledPath(const std::string& path) {
+    return path.size() >= COMPILED_EXTENSION.size() &&
+           std::string_view(path).substr(path.size() - COMPILED_EXTENSION.size()) == COMPILED_EXTENSION;
+}
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+} // namespace
+
+std::shared_ptr<const ResolvedConfig> ResolvedConfig::load(const std::string& path, std::string& error) {
+    std::vector<uint8_t> bytes;
+    if (!readFile(path, bytes)) {
+        error = "cannot read " + path;
+        return nullptr;
+    }
+
+    if (isCompiledPath(path)) {
+        auto config = std::make_shared<ResolvedConfig>();
+        switch (config->loadCompiled(bytes)) {
+            case CompiledStatus::Loaded:
+                return config;
+            case CompiledStatus::Corrupt:
+                error = path + " is damaged";
+                return nullptr;
+            case CompiledStatus::Stale:
+                break;
+        }
+        // Compiled against another schema; the source text still holds
+        const std::string source = path.substr(0, path.size() - 1);
+        if (!readFile(source, bytes)) {
+            error = path + " was compiled for another schema and " + source + " cannot be read";
+            return nullptr;
+        }
+    }
+
+    std::vector<LineError> errors;
+    uint32_t lines[CONFIG_PARAM_COUNT];
+    auto config = parse(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()),
+                        errors, lines);
+    if (!config) {
+        error = "line " + std::to_string(errors.front().line) + ": " + errors.front().message;
+    }
+    return config;
+}
+
+bool ResolvedConfig::saveCompiled(const std::string& path, std::string& error) const {
+    std::vector<uint8_t> out;
+    CompiledHeader header{};
+    std::memcpy(header.magic, "FISCCFG1", sizeof(header.magic));
+    header.version = COMPILED_VERSION;
+    header.paramCount = CONFIG_PARAM_COUNT;
+    header.schemaHash = FiscConfigSchema::hash();
+    append(out, header);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(values),
+               reinterpret_cast<const uint8_t*>(values + CONFIG_PARAM_COUNT));
+    for (const auto& text : texts) {
+        append(out, static_cast<uint32_t>(text.size()));
+        out.insert(out.end(), text.begin(), text.end());
+    }
+    append(out, crc32(out.data(), out.size()));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char*>(out.data()), out.size())) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+ResolvedConfig::CompiledStatus ResolvedConfig::loadCompiled(const std::vector<uint8_t>& bytes) {
+    CompiledHeader header;
+    const size_t valuesEnd = sizeof(header) + sizeof(values);
+    if (bytes.size() < sizeof(header)) {
+        return CompiledStatus::Corrupt;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, "FISCCFG1", sizeof(header.magic)) != 0) {
+        return CompiledStatus::Corrupt;
+    }
+    if (header.version != COMPILED_VERSION || header.paramCount != CONFIG_PARAM_COUNT ||
+        header.schemaHash != FiscConfigSchema::hash()) {
+        return CompiledStatus::Stale;
+    }
+
+    uint32_t storedCrc;
+    if (bytes.size() < valuesEnd + sizeof(storedCrc)) {
+        return CompiledStatus::Corrupt;
+    }
+    const size_t crcOffset = bytes.size() - sizeof(storedCrc);
+    std::memcpy(&storedCrc, bytes.data() + crcOffset, sizeof(storedCrc));
+    if (storedCrc != crc32(bytes.data(), crcOffset)) {
+        return CompiledStatus::Corrupt;
+    }
+
+    // Values are re-checked against the rules, which the hash does not cover
+    std::memcpy(values, bytes.data() + sizeof(header), sizeof(values));
+    size_t offset = valuesEnd;
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        const auto& def = FiscConfigSchema::get(static_cast<ConfigParam>(i));
+        if (!FiscConfigSchema::checkValue(def, values[i])) {
+            return CompiledStatus::Stale;
+        }
+        uint32_t length;
+        if (crcOffset - offset < sizeof(length)) {
+            return CompiledStatus::Corrupt;
+        }
+        std::memcpy(&length, bytes.data() + offset, sizeof(length));
+        offset += sizeof(length);
+        if (crcOffset - offset < length) {
+            return CompiledStatus::Corrupt;
+        }
+        texts[i].assign(reinterpret_cast<const char*>(bytes.data() + offset), length);
+        offset += length;
+        if (def.textRule && !def.textRule(texts[i])) {
+            return CompiledStatus::Stale;
+        }
+    }
+    return offset == crcOffset ? CompiledStatus::Loaded : CompiledStatus::Corrupt;
+}
@@ -93,8 +93,8 @@ bool FiscConfigParser::validateValue(const std::string& param, const std::string
 // Static methods
 std::vector<std::string> FiscConfigParser::getAvailableParameters() {
     std::vector<std::string> params;
-    for (const auto& [param, def] : FiscConfigSchema::getSchema()) {
-        params.push_back(param);
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        params.emplace_back(FiscConfigSchema::get(static_cast<ConfigParam>(i)).name);
     }
     return params;
 }
@@ -104,18 +104,17 @@ std::string FiscConfigParser::getParameterDescription(const std::string& param)
 }
 
 std::vector<std::string> FiscConfigParser::getEnumValues(const std::string& param) {
-    const auto& schema = FiscConfigSchema::getSchema();
-    auto it = schema.find(param);
-    if (it != schema.end() && it->second.type == FiscConfigSchema::ParamType::ENUM) {
-        return it->second.enumValues;
+    const auto* def = FiscConfigSchema::find(param);
+    if (!def || def->type != FiscConfigSchema::ParamType::ENUM) {
+        return {};
     }
-    return {};
+    return std::vector<std::string>(def->enumValues, def->enumValues + def->enumCount);
 }
 
 bool FiscConfigParser::initializeDefaults() {
-    const auto& schema = FiscConfigSchema::getSchema();
-    for (const auto& [param, def] : schema) {
-        configData[param] = def.defaultValue;
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        const auto& def = FiscConfigSchema::get(static_cast<ConfigParam>(i));
+        configData[std::string(def.name)] = def.defaultValue;
     }
     return true;
 } 
\ No newline at end of file
@@ -1,360 +1,361 @@
 #include "FiscConfigSchema.hpp"
-#include <regex>
-#include <algorithm>
 
-const std::map<std::string, FiscConfigSchema::ParamDefinition> FiscConfigSchema::schema = 
-    FiscConfigSchema::createSchema();
+namespace {
 
-std::map<std::string, FiscConfigSchema::ParamDefinition> FiscConfigSchema::createSchema() {
-    std::map<std::string, ParamDefinition> s;
-    
-    // Memory configuration
-    s["MEMORY_SIZE"] = {
-        ParamType::INTEGER,
-        "Total memory size in bytes (must be power of 2)",
-        "65536",
-        {},
-        [](const std::string& val) {
-            try {
-                auto size = std::stoull(val);
-                return (size & (size - 1)) == 0; // Check power of 2
-            } catch (...) {
-                return false;
-            }
+using ParamDefinition = FiscConfigSchema::ParamDefinition;
+using ParamType = FiscConfigSchema::ParamType;
+
+// Unsigned decimal, or hex with an optional 0x prefix; the whole string must parse
+constexpr bool parseNumber(std::string_view text, unsigned base, uint64_t& value) {
+    if (base == 16 && text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+    }
+    if (text.empty()) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (char c : text) {
+        unsigned digit = 0;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
         }
-    };
-
-    s["START_ADDRESS"] = {
-        ParamType::HEX,
-        "Program start address (must be aligned to 4 bytes)",
-        "0x0000",
-        {},
-        [](const std::string& val) {
-            try {
-                auto addr = std::stoull(val, nullptr, 16);
-                return (addr & 0x3) == 0; // Check 4-byte alignment
-            } catch (...) {
-                return false;
-            }
+        if (result > (~uint64_t(0) - digit) / base) {
+            return false;
         }
-    };
+        result = result * base + digit;
+    }
+    value = result;
+    return true;
+}
+
+constexpr bool isPowerOfTwo(uint64_t value) {
+    return (value & (value - 1)) == 0;
+}
+
+constexpr bool isWordAligned(uint64_t value) {
+    return (value & 0x3) == 0;
+}
+
+constexpr bool isNotEmpty(std::string_view value) {
+    return !value.empty();
+}
+
+constexpr ParamDefinition number(ConfigParam param, std::string_view name, ParamType type,
+                                 std::string_view description, std::string_view defaultValue,
+                                 FiscConfigSchema::NumberRule rule) {
+    return {param, name, type, description, defaultValue, nullptr, 0, rule, nullptr};
+}
+
+constexpr ParamDefinition boolean(ConfigParam param, std::string_view name,
+                                  std::string_view description, std::string_view defaultValue) {
+    return {param, name, ParamType::BOOLEAN, description, defaultValue, nullptr, 0, nullptr, nullptr};
+}
+
+template <size_t N>
+constexpr ParamDefinition choice(ConfigParam param, std::string_view name, std::string_view description,
+                                 std::string_view defaultValue, const std::string_view (&values)[N]) {
+    return {param, name, ParamType::ENUM, description, defaultValue, values, N, nullptr, nullptr};
+}
+
+constexpr ParamDefinition text(ConfigParam param, std::string_view name, std::string_view description,
+                               std::string_view defaultValue, FiscConfigSchema::TextRule rule) {
+    return {param, name, ParamType::STRING, description, defaultValue, nullptr, 0, nullptr, rule};
+}
+
+// Marks a parameter a running VPU picks up at its next quantum boundary
+constexpr ParamDefinition live(ParamDefinition def) {
+    def.hotReload = true;
+    return def;
+}
+
+// ENUM values in ordinal order
+constexpr std::string_view EXECUTION_ENGINES[] = {"interpreter", "block", "jit"};
+constexpr std::string_view PIPELINES[] = {"3-stage", "5-stage", "7-stage"};
+constexpr std::string_view ASSOCIATIVITIES[] = {"direct", "2", "4", "8", "16", "full"};
+constexpr std::string_view WRITE_POLICIES[] = {"write-back", "write-through"};
+constexpr std::string_view DEBUG_LEVELS[] = {"none", "minimal", "normal", "verbose", "debug"};
+constexpr std::string_view BACKPRESSURES[] = {"drop", "block"};
+constexpr std::string_view ARCHITECTURES[] = {
+    // RISC-V variants
+    "RISC-V-32", "RISC-V-64", "RISC-V-128",
+    // x86 family
+    "8086", "80186", "80286", "80386", "80486", "Pentium",
+    "80386SX", "80386DX", "80486SX", "80486DX", "80486DX2", "80486DX4",
+    // 8-bit architectures
+    "8080", "Z80", "6502", "6800",
+    // 16-bit architectures
+    "65816", "68000",
+    // 4-bit architectures
+    "Intel-4004", "Intel-4040"
+};
+constexpr std::string_view ADDRESS_BUS_WIDTHS[] = {"4", "8", "16", "20", "24", "32", "64", "128"};
+constexpr std::string_view DATA_BUS_WIDTHS[] = {"4", "8", "16", "32", "64", "128"};
+constexpr std::string_view BYTE_ORDERS[] = {"little", "big", "bi"};
+constexpr std::string_view FPU_TYPES[] = {"none", "8087", "80287", "80387", "80487", "internal"};
+constexpr std::string_view MMU_TYPES[] = {"none", "basic", "paging", "segmentation", "paging_and_segmentation"};
+constexpr std::string_view SIMD_EXTENSIONS[] = {"none", "MMX", "SSE", "SSE2", "SSE3", "SSSE3", "SSE4", "AVX"};
+
+constexpr ParamDefinition PARAMETERS[] = {
+    // Memory configuration
+    number(ConfigParam::MEMORY_SIZE, "MEMORY_SIZE", ParamType::INTEGER,
+           "Total memory size in bytes (must be power of 2)", "65536", isPowerOfTwo),
+    boolean(ConfigParam::HUGE_PAGES, "HUGE_PAGES",
+            "Back guest memory with transparent huge pages where the host supports them", "false"),
+    number(ConfigParam::START_ADDRESS, "START_ADDRESS", ParamType::HEX,
+           "Program start address (must be aligned to 4 bytes)", "0x0000", isWordAligned),
+    text(ConfigParam::PROGRAM_IMAGE, "PROGRAM_IMAGE",
+         "ELF or raw binary to load (empty runs the mini BIOS; raw images load at START_ADDRESS)", "", nullptr),
 
     // CPU Configuration
-    s["CPU_FREQUENCY"] = {
-        ParamType::INTEGER,
-        "CPU frequency in Hz (1000-1000000000)",
-        "1000000",
-        {},
-        [](const std::string& val) {
-            try {
-                auto freq = std::stoull(val);
-                return freq >= 1000 && freq <= 1000000000;
-            } catch (...) {
-                return false;
-            }
-        }
-    };
-
-    s["PIPELINE_STAGES"] = {
-        ParamType::ENUM,
-        "Pipeline configuration",
-        "5-stage",
-        {"3-stage", "5-stage", "7-stage"},
-        [](const std::string& val) {
-            return val == "3-stage" || val == "5-stage" || val == "7-stage";
-        }
-    };
+    live(number(ConfigParam::CPU_FREQUENCY, "CPU_FREQUENCY", ParamType::INTEGER,
+                "CPU frequency in Hz (1000-1000000000)", "1000000",
+                [](uint64_t freq) { return freq >= 1000 && freq <= 1000000000; })),
+    live(boolean(ConfigParam::CPU_THROTTLE, "CPU_THROTTLE",
+                 "Pace execution to CPU_FREQUENCY * CLOCK_MULTIPLIER (false runs unthrottled)", "true")),
+    number(ConfigParam::QUANTUM_SIZE, "QUANTUM_SIZE", ParamType::INTEGER,
+           "Maximum instructions executed per scheduling quantum (1-1000000)", "10000",
+           [](uint64_t size) { return size >= 1 && size <= 1000000; }),
+    choice(ConfigParam::EXECUTION_ENGINE, "EXECUTION_ENGINE",
+           "Execution engine (interpreter, block: basic-block dispatch, jit: x86-64 translation)",
+           "interpreter", EXECUTION_ENGINES),
+    choice(ConfigParam::PIPELINE_STAGES, "PIPELINE_STAGES", "Pipeline configuration", "5-stage", PIPELINES),
 
     // Cache Configuration
-    s["ICACHE_SIZE"] = {
-        ParamType::INTEGER,
-        "Instruction cache size in bytes (power of 2)",
-        "4096",
-        {},
-        [](const std::string& val) {
-            try {
-                auto size = std::stoull(val);
-                return (size & (size - 1)) == 0;
-            } catch (...) {
-                return false;
-            }
-        }
-    };
-
-    s["DCACHE_SIZE"] = {
-        ParamType::INTEGER,
-        "Data cache size in bytes (power of 2)",
-        "4096",
-        {},
-        [](const std::string& val) {
-            try {
-                auto size = std::stoull(val);
-                return (size & (size - 1)) == 0;
-            } catch (...) {
-                return false;
-            }
-        }
-    };
+    number(ConfigParam::ICACHE_SIZE, "ICACHE_SIZE", ParamType::INTEGER,
+           "Instruction cache size in bytes (power of 2)", "4096", isPowerOfTwo),
+    number(ConfigParam::DCACHE_SIZE, "DCACHE_SIZE", ParamType::INTEGER,
+           "Data cache size in bytes (power of 2)", "4096", isPowerOfTwo),
+    boolean(ConfigParam::CACHE_SIMULATION, "CACHE_SIMULATION",
+            "Model L1 instruction/data caches and count hits, misses and evictions", "false"),
+    number(ConfigParam::CACHE_LINE_SIZE, "CACHE_LINE_SIZE", ParamType::INTEGER,
+           "Cache line size in bytes (power of 2, 4-256)", "64",
+           [](uint64_t size) { return size >= 4 && size <= 256 && isPowerOfTwo(size); }),
+    choice(ConfigParam::CACHE_ASSOCIATIVITY, "CACHE_ASSOCIATIVITY",
+           "Cache organisation (direct mapped, N-way set associative or fully associative)", "4",
+           ASSOCIATIVITIES),
+    choice(ConfigParam::CACHE_WRITE_POLICY, "CACHE_WRITE_POLICY",
+           "Data cache write policy (write-back allocates on write, write-through does not)", "write-back",
+           WRITE_POLICIES),
 
     // BIOS Configuration
-    s["BIOS_ENABLE"] = {
-        ParamType::BOOLEAN,
-        "Enable BIOS initialization",
-        "true",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
-        }
-    };
-
-    s["BIOS_LOCATION"] = {
-        ParamType::HEX,
-        "BIOS memory location",
-        "0x0000",
-        {},
-        [](const std::string& val) {
-            try {
-                auto addr = std::stoull(val, nullptr, 16);
-                return (addr & 0x3) == 0;
-            } catch (...) {
-                return false;
-            }
-        }
-    };
+    boolean(ConfigParam::BIOS_ENABLE, "BIOS_ENABLE", "Enable BIOS initialization", "true"),
+    number(ConfigParam::BIOS_LOCATION, "BIOS_LOCATION", ParamType::HEX,
+           "BIOS memory location", "0x0000", isWordAligned),
 
     // Debug Options
-    s["DEBUG_LEVEL"] = {
-        ParamType::ENUM,
-        "Debug output level",
-        "normal",
-        {"none", "minimal", "normal", "verbose", "debug"},
-        [](const std::string& val) {
-            std::vector<std::string> valid = {"none", "minimal", "normal", "verbose", "debug"};
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["TRACE_INSTRUCTIONS"] = {
-        ParamType::BOOLEAN,
-        "Enable instruction tracing",
-        "false",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
-        }
-    };
+    live(choice(ConfigParam::DEBUG_LEVEL, "DEBUG_LEVEL", "Debug output level", "normal", DEBUG_LEVELS)),
+    choice(ConfigParam::OUTPUT_BACKPRESSURE, "OUTPUT_BACKPRESSURE",
+           "What a full VPU output queue does (drop messages and count them, or block the VPU)", "drop",
+           BACKPRESSURES),
+    live(boolean(ConfigParam::TRACE_INSTRUCTIONS, "TRACE_INSTRUCTIONS", "Enable instruction tracing", "false")),
+    text(ConfigParam::TRACE_FILE, "TRACE_FILE",
+         "Binary trace output written when TRACE_INSTRUCTIONS is on (decode with fisc_trace)", "fisc_trace.bin",
+         isNotEmpty),
+    boolean(ConfigParam::TRACE_COMPRESSION, "TRACE_COMPRESSION",
+            "Gzip-compress the instruction trace (requires a zlib build)", "false"),
 
     // Architecture Configuration
-    s["ARCHITECTURE"] = {
-        ParamType::ENUM,
-        "CPU Architecture type",
-        "RISC-V-32",
-        {
-            // RISC-V variants
-            "RISC-V-32", "RISC-V-64", "RISC-V-128",
-            // x86 family
-            "8086", "80186", "80286", "80386", "80486", "Pentium",
-            "80386SX", "80386DX", "80486SX", "80486DX", "80486DX2", "80486DX4",
-            // 8-bit architectures
-            "8080", "Z80", "6502", "6800",
-            // 16-bit architectures
-            "65816", "68000",
-            // 4-bit architectures
-            "Intel-4004", "Intel-4040"
-        },
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {
-                "RISC-V-32", "RISC-V-64", "RISC-V-128",
-                "8086", "80186", "80286", "80386", "80486", "Pentium",
-                "80386SX", "80386DX", "80486SX", "80486DX", "80486DX2", "80486DX4",
-                "8080", "Z80", "6502", "6800",
-                "65816", "68000",
-                "Intel-4004", "Intel-4040"
-            };
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["INSTRUCTION_SET_EXTENSIONS"] = {
-        ParamType::STRING,
-        "Enabled instruction set extensions (comma-separated)",
-        "base",
-        {},
-        [](const std::string& val) {
-            // Simple validation - could be enhanced
-            return !val.empty();
-        }
-    };
-
-    s["ADDRESS_BUS_WIDTH"] = {
-        ParamType::ENUM,
-        "Address bus width in bits",
-        "32",
-        {"4", "8", "16", "20", "24", "32", "64", "128"},
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {"4", "8", "16", "20", "24", "32", "64", "128"};
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["DATA_BUS_WIDTH"] = {
-        ParamType::ENUM,
-        "Data bus width in bits",
-        "32",
-        {"4", "8", "16", "32", "64", "128"},
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {"4", "8", "16", "32", "64", "128"};
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["ENDIANNESS"] = {
-        ParamType::ENUM,
-        "Memory byte order",
-        "little",
-        {"little", "big", "bi"},
-        [](const std::string& val) {
-            return val == "little" || val == "big" || val == "bi";
-        }
-    };
+    choice(ConfigParam::ARCHITECTURE, "ARCHITECTURE", "CPU Architecture type", "RISC-V-32", ARCHITECTURES),
+    text(ConfigParam::INSTRUCTION_SET_EXTENSIONS, "INSTRUCTION_SET_EXTENSIONS",
+         "Enabled instruction set extensions (comma-separated)", "base", isNotEmpty),
+    choice(ConfigParam::ADDRESS_BUS_WIDTH, "ADDRESS_BUS_WIDTH", "Address bus width in bits", "32",
+           ADDRESS_BUS_WIDTHS),
+    choice(ConfigParam::DATA_BUS_WIDTH, "DATA_BUS_WIDTH", "Data bus width in bits", "32", DATA_BUS_WIDTHS),
+    choice(ConfigParam::ENDIANNESS, "ENDIANNESS", "Memory byte order", "little", BYTE_ORDERS),
 
     // Architecture-specific features
-    s["X86_REAL_MODE"] = {
-        ParamType::BOOLEAN,
-        "Enable x86 real mode (16-bit mode)",
-        "false",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
-        }
-    };
-
-    s["X86_PROTECTED_MODE"] = {
-        ParamType::BOOLEAN,
-        "Enable x86 protected mode",
-        "true",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
-        }
-    };
-
-    s["SEGMENT_REGISTERS"] = {
-        ParamType::BOOLEAN,
-        "Enable segmentation (for x86 architectures)",
-        "false",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
-        }
-    };
-
-    s["FPU_TYPE"] = {
-        ParamType::ENUM,
-        "Floating-point unit type",
-        "none",
-        {"none", "8087", "80287", "80387", "80487", "internal"},
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {"none", "8087", "80287", "80387", "80487", "internal"};
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["MMU_TYPE"] = {
-        ParamType::ENUM,
-        "Memory Management Unit type",
-        "none",
-        {"none", "basic", "paging", "segmentation", "paging_and_segmentation"},
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {
-                "none", "basic", "paging", "segmentation", "paging_and_segmentation"
-            };
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
+    boolean(ConfigParam::X86_REAL_MODE, "X86_REAL_MODE", "Enable x86 real mode (16-bit mode)", "false"),
+    boolean(ConfigParam::X86_PROTECTED_MODE, "X86_PROTECTED_MODE", "Enable x86 protected mode", "true"),
+    boolean(ConfigParam::SEGMENT_REGISTERS, "SEGMENT_REGISTERS",
+            "Enable segmentation (for x86 architectures)", "false"),
+    choice(ConfigParam::FPU_TYPE, "FPU_TYPE", "Floating-point unit type", "none", FPU_TYPES),
+    choice(ConfigParam::MMU_TYPE, "MMU_TYPE", "Memory Management Unit type", "none", MMU_TYPES),
 
     // Architecture Extensions
-    s["SIMD_SUPPORT"] = {
-        ParamType::ENUM,
-        "SIMD instruction set support",
-        "none",
-        {"none", "MMX", "SSE", "SSE2", "SSE3", "SSSE3", "SSE4", "AVX"},
-        [](const std::string& val) {
-            const std::vector<std::string> valid = {
-                "none", "MMX", "SSE", "SSE2", "SSE3", "SSSE3", "SSE4", "AVX"
-            };
-            return std::find(valid.begin(), valid.end(), val) != valid.end();
-        }
-    };
-
-    s["VIRTUALIZATION_SUPPORT"] = {
-        ParamType::BOOLEAN,
-        "Enable hardware virtualization support",
-        "false",
-        {},
-        [](const std::string& val) {
-            return val == "true" || val == "false";
+    choice(ConfigParam::SIMD_SUPPORT, "SIMD_SUPPORT", "SIMD instruction set support", "none", SIMD_EXTENSIONS),
+    boolean(ConfigParam::VIRTUALIZATION_SUPPORT, "VIRTUALIZATION_SUPPORT",
+            "Enable hardware virtualization support", "false"),
+
+    // Architecture-specific timing parameters
+    number(ConfigParam::CLOCK_MULTIPLIER, "CLOCK_MULTIPLIER", ParamType::INTEGER,
+           "CPU clock multiplier (1-100)", "1",
+           [](uint64_t mult) { return mult >= 1 && mult <= 100; }),
+    number(ConfigParam::WAIT_STATES, "WAIT_STATES", ParamType::INTEGER,
+           "Memory wait states (0-7)", "0",
+           [](uint64_t states) { return states <= 7; }),
+};
+static_assert(sizeof(PARAMETERS) / sizeof(PARAMETERS[0]) == CONFIG_PARAM_COUNT,
+              "PARAMETERS must define every ConfigParam");
+
+constexpr bool inParamOrder() {
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        if (PARAMETERS[i].param != static_cast<ConfigParam>(i)) {
+            return false;
         }
-    };
-
-    // Add architecture-specific timing parameters
-    s["CLOCK_MULTIPLIER"] = {
-        ParamType::INTEGER,
-        "CPU clock multiplier (1-100)",
-        "1",
-        {},
-        [](const std::string& val) {
-            try {
-                auto mult = std::stoi(val);
-                return mult >= 1 && mult <= 100;
-            } catch (...) {
-                return false;
+    }
+    return true;
+}
+static_assert(inParamOrder(), "PARAMETERS must be in ConfigParam order");
+
+constexpr bool parseDefinition(const ParamDefinition& def, std::string_view value, uint64_t& result) {
+    switch (def.type) {
+        case ParamType::INTEGER:
+        case ParamType::HEX:
+            return parseNumber(value, def.type == ParamType::HEX ? 16 : 10, result) &&
+                   (!def.numberRule || def.numberRule(result));
+        case ParamType::BOOLEAN:
+            result = value == "true";
+            return value == "true" || value == "false";
+        case ParamType::ENUM:
+            for (size_t i = 0; i < def.enumCount; ++i) {
+                if (value == def.enumValues[i]) {
+                    result = i;
+                    return true;
+                }
             }
+            return false;
+        case ParamType::STRING:
+            result = 0;
+            return !def.textRule || def.textRule(value);
+    }
+    return false;
+}
+
+constexpr bool defaultsValid() {
+    for (const auto& def : PARAMETERS) {
+        uint64_t value = 0;
+        if (!parseDefinition(def, def.defaultValue, value)) {
+            return false;
         }
-    };
-
-    s["WAIT_STATES"] = {
-        ParamType::INTEGER,
-        "Memory wait states (0-7)",
-        "0",
-        {},
-        [](const std::string& val) {
-            try {
-                auto states = std::stoi(val);
-                return states >= 0 && states <= 7;
-            } catch (...) {
-                return false;
-            }
+    }
+    return true;
+}
+static_assert(defaultsValid(), "every default must pass its own validation");
+
+// Perfect hash of the parameter names: the first seed for which FNV-1a
+// sends every name to its own slot, found at compile time
+constexpr size_t HASH_SLOTS = 128;
+
+constexpr uint32_t hashName(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+struct NameHash {
+    uint32_t seed;
+    uint8_t slots[HASH_SLOTS];  // Parameter index + 1; 0 is empty
+};
+
+constexpr NameHash buildNameHash() {
+    for (uint32_t seed = 1; seed < 10000; ++seed) {
+        NameHash table{seed, {}};
+        bool collision = false;
+        for (size_t i = 0; i < CONFIG_PARAM_COUNT && !collision; ++i) {
+            uint8_t& slot = table.slots[hashName(PARAMETERS[i].name, seed) % HASH_SLOTS];
+            collision = slot != 0;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (!collision) {
+            return table;
         }
-    };
+    }
+    return NameHash{0, {}};
+}
+
+constexpr NameHash NAME_HASH = buildNameHash();
+static_assert(NAME_HASH.seed != 0, "no perfect hash seed for the parameter names");
 
-    return s;
+// FNV-1a over everything that gives a stored value its meaning: parameter
+// order, names, types and enum values in ordinal order
+constexpr uint64_t hashByte(uint64_t hash, uint8_t byte) {
+    return (hash ^ byte) * 1099511628211ull;
 }
 
-const std::map<std::string, FiscConfigSchema::ParamDefinition>& FiscConfigSchema::getSchema() {
-    return schema;
+constexpr uint64_t hashField(uint64_t hash, std::string_view field) {
+    for (char c : field) {
+        hash = hashByte(hash, static_cast<uint8_t>(c));
+    }
+    return hashByte(hash, 0);  // Terminator, so "ab","c" and "a","bc" differ
 }
 
-bool FiscConfigSchema::validateParameter(const std::string& param, const std::string& value) {
-    auto it = schema.find(param);
-    if (it == schema.end()) {
-        return false;
+constexpr uint64_t schemaHash() {
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& def : PARAMETERS) {
+        hash = hashByte(hashField(hash, def.name), static_cast<uint8_t>(def.type));
+        for (size_t i = 0; i < def.enumCount; ++i) {
+            hash = hashField(hash, def.enumValues[i]);
+        }
     }
-    return it->second.validator(value);
+    return hash;
 }
 
-std::optional<std::string> FiscConfigSchema::getDefaultValue(const std::string& param) {
-    auto it = schema.find(param);
-    if (it == schema.end()) {
+constexpr uint64_t SCHEMA_HASH = schemaHash();
+
+} // namespace
+
+const FiscConfigSchema::ParamDefinition& FiscConfigSchema::get(ConfigParam param) {
+    return PARAMETERS[static_cast<size_t>(param)];
+}
+
+const FiscConfigSchema::ParamDefinition* FiscConfigSchema::find(std::string_view name) {
+    uint8_t slot = NAME_HASH.slots[hashName(name, NAME_HASH.seed) % HASH_SLOTS];
+    if (slot == 0 || PARAMETERS[slot - 1].name != name) {
+        return nullptr;
+    }
+    return &PARAMETERS[slot - 1];
+}
+
+bool FiscConfigSchema::parseValue(const ParamDefinition& def, std::string_view value, uint64_t& result) {
+    return parseDefinition(def, value, result);
+}
+
+bool FiscConfigSchema::checkValue(const ParamDefinition& def, uint64_t value) {
+    switch (def.type) {
+        case ParamType::INTEGER:
+        case ParamType::HEX:
+            return !def.numberRule || def.numberRule(value);
+        case ParamType::BOOLEAN:
+            return value <= 1;
+        case ParamType::ENUM:
+            return value < def.enumCount;
+        case ParamType::STRING:
+            return value == 0;
+    }
+    return false;
+}
+
+uint64_t FiscConfigSchema::hash() {
+    return SCHEMA_HASH;
+}
+
+bool FiscConfigSchema::validateParameter(std::string_view param, std::string_view value) {
+    const ParamDefinition* def = find(param);
+    uint64_t parsed;
+    return def && parseDefinition(*def, value, parsed);
+}
+
+std::optional<std::string> FiscConfigSchema::getDefaultValue(std::string_view param) {
+    const ParamDefinition* def = find(param);
+    if (!def) {
         return std::nullopt;
     }
-    return it->second.defaultValue;
+    return std::string(def->defaultValue);
 }
 
-std::string FiscConfigSchema::getDescription(const std::string& param) {
-    auto it = schema.find(param);
-    if (it == schema.end()) {
+std::string FiscConfigSchema::getDescription(std::string_view param) {
+    const ParamDefinition* def = find(param);
+    if (!def) {
         return "Unknown parameter";
     }
-    return it->second.description;
-} 
\ No newline at end of file
+    return std::string(def->description);
+}
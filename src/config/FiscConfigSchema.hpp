@@ -1,12 +1,56 @@
 #ifndef FISC_CONFIG_SCHEMA_HPP
 #define FISC_CONFIG_SCHEMA_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <map>
-#include <vector>
-#include <functional>
+#include <string_view>
 #include <optional>
 
+// One entry per schema parameter, in schema table order
+enum class ConfigParam : uint8_t {
+    MEMORY_SIZE,
+    HUGE_PAGES,
+    START_ADDRESS,
+    PROGRAM_IMAGE,
+    CPU_FREQUENCY,
+    CPU_THROTTLE,
+    QUANTUM_SIZE,
+    EXECUTION_ENGINE,
+    PIPELINE_STAGES,
+    ICACHE_SIZE,
+    DCACHE_SIZE,
+    CACHE_SIMULATION,
+    CACHE_LINE_SIZE,
+    CACHE_ASSOCIATIVITY,
+    CACHE_WRITE_POLICY,
+    BIOS_ENABLE,
+    BIOS_LOCATION,
+    DEBUG_LEVEL,
+    OUTPUT_BACKPRESSURE,
+    TRACE_INSTRUCTIONS,
+    TRACE_FILE,
+    TRACE_COMPRESSION,
+    ARCHITECTURE,
+    INSTRUCTION_SET_EXTENSIONS,
+    ADDRESS_BUS_WIDTH,
+    DATA_BUS_WIDTH,
+    ENDIANNESS,
+    X86_REAL_MODE,
+    X86_PROTECTED_MODE,
+    SEGMENT_REGISTERS,
+    FPU_TYPE,
+    MMU_TYPE,
+    SIMD_SUPPORT,
+    VIRTUALIZATION_SUPPORT,
+    CLOCK_MULTIPLIER,
+    WAIT_STATES
+};
+constexpr size_t CONFIG_PARAM_COUNT = static_cast<size_t>(ConfigParam::WAIT_STATES) + 1;
+
+// The schema is a constant table (FiscConfigSchema.cpp): no static
+// initialisation, and lookups and validation never allocate. Names are
+// found through a perfect hash computed at compile time.
 class FiscConfigSchema {
 public:
     enum class ParamType {
@@ -17,22 +61,39 @@ public:
         ENUM
     };
 
+    // Checks beyond the type; numeric parameters receive the parsed value
+    using NumberRule = bool (*)(uint64_t value);
+    using TextRule = bool (*)(std::string_view value);
+
     struct ParamDefinition {
+        ConfigParam param;
+        std::string_view name;
         ParamType type;
-        std::string description;
-        std::string defaultValue;
-        std::vector<std::string> enumValues;  // Used for ENUM type
-        std::function<bool(const std::string&)> validator;
+        std::string_view description;
+        std::string_view defaultValue;
+        const std::string_view* enumValues;  // ENUM values in ordinal order
+        size_t enumCount;
+        NumberRule numberRule;  // INTEGER and HEX; null accepts any value
+        TextRule textRule;      // STRING; null accepts any value
+        bool hotReload = false; // Applies to a running VPU at its next quantum
     };
 
-    static const std::map<std::string, ParamDefinition>& getSchema();
-    static bool validateParameter(const std::string& param, const std::string& value);
-    static std::optional<std::string> getDefaultValue(const std::string& param);
-    static std::string getDescription(const std::string& param);
+    static const ParamDefinition& get(ConfigParam param);
+    static const ParamDefinition* find(std::string_view name);  // Null for unknown names
+
+    // Parses and checks a value; ENUM values yield their ordinal, BOOLEAN
+    // 0 or 1, STRING 0
+    static bool parseValue(const ParamDefinition& def, std::string_view value, uint64_t& result);
+    // Checks an already parsed value, as parseValue() would have produced it
+    static bool checkValue(const ParamDefinition& def, uint64_t value);
+
+    // Fingerprint of parameter order, names, types and enum values; stored
+    // values are only meaningful under the schema hash they were written with
+    static uint64_t hash();
 
-private:
-    static std::map<std::string, ParamDefinition> createSchema();
-    static const std::map<std::string, ParamDefinition> schema;
+    static bool validateParameter(std::string_view param, std::string_view value);
+    static std::optional<std::string> getDefaultValue(std::string_view param);
+    static std::string getDescription(std::string_view param);
 };
 
-#endif // FISC_CONFIG_SCHEMA_HPP 
\ No newline at end of file
+#endif // FISC_CONFIG_SCHEMA_HPP
@@ -0,0 +1,98 @@
+#include "ResolvedConfig.hpp"
+#include "FiscConfigParser.hpp"
+
+std::shared_ptr<const ResolvedConfig> ResolvedConfig::resolve(const FiscConfigParser& parser, std::string& error) {
+    auto config = std::make_shared<ResolvedConfig>();
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        const auto param = static_cast<ConfigParam>(i);
+        if (!config->assign(param, parser.getParameter(std::string(name(param))), error)) {
+            return nullptr;
+        }
+    }
+    return config;
+}
+
+std::shared_ptr<const ResolvedConfig> ResolvedConfig::withParameter(ConfigParam param, const std::string& value,
+                                                                    std::string& error) const {
+    auto config = std::make_shared<ResolvedConfig>(*this);
+    if (!config->assign(param, value, error)) {
+        return nullptr;
+    }
+    return config;
+}
+
+std::shared_ptr<const ResolvedConfig> ResolvedConfig::parse(std::string_view text, std::vector<LineError>& errors,
+                                                            uint32_t (&lines)[CONFIG_PARAM_COUNT]) {
+    auto config = std::make_shared<ResolvedConfig>();
+    std::string error;
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        const auto param = static_cast<ConfigParam>(i);
+        config->assign(param, FiscConfigSchema::get(param).defaultValue, error);
+        lines[i] = 0;
+    }
+
+    // Same rules as FiscConfigParser::parseLine: comments and lines
+    // without '=' are skipped, later settings win
+    const size_t errorCount = errors.size();
+    uint32_t lineNumber = 0;
+    while (!text.empty()) {
+        ++lineNumber;
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t equalPos = line.find('=');
+        if (equalPos == std::string_view::npos) {
+            continue;
+        }
+
+        auto trim = [](std::string_view field) {
+            size_t first = field.find_first_not_of(" \t");
+            if (first == std::string_view::npos) {
+                return std::string_view();
+            }
+            return field.substr(first, field.find_last_not_of(" \t") - first + 1);
+        };
+        std::string_view paramName = trim(line.substr(0, equalPos));
+        std::string_view value = trim(line.substr(equalPos + 1));
+
+        const auto* def = FiscConfigSchema::find(paramName);
+        if (!def) {
+            errors.push_back({lineNumber, "unknown parameter " + std::string(paramName)});
+        } else if (!config->assign(def->param, value, error)) {
+            errors.push_back({lineNumber, error});
+        } else {
+            lines[index(def->param)] = lineNumber;
+        }
+    }
+    if (errors.size() != errorCount) {
+        return nullptr;
+    }
+    return config;
+}
+
+const char* ResolvedConfig::name(ConfigParam param) {
+    return FiscConfigSchema::get(param).name.data();
+}
+
+bool ResolvedConfig::lookup(const std::string& name, ConfigParam& param) {
+    const auto* def = FiscConfigSchema::find(name);
+    if (!def) {
+        return false;
+    }
+    param = def->param;
+    return true;
+}
+
+bool ResolvedConfig::assign(ConfigParam param, std::string_view value, std::string& error) {
+    uint64_t resolved;
+    if (!FiscConfigSchema::parseValue(FiscConfigSchema::get(param), value, resolved)) {
+        error = "Invalid value for " + std::string(name(param)) + ": " + std::string(value);
+        return false;
+    }
+    values[index(param)] = resolved;
+    texts[index(param)] = value;
+    return true;
+}
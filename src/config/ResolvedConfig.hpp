@@ -0,0 +1,71 @@
+#ifndef RESOLVED_CONFIG_HPP
+#define RESOLVED_CONFIG_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FiscConfigSchema.hpp"
+
+class FiscConfigParser;
+
+// Ordinals of ENUM parameters, in schema value order
+enum class ExecutionEngine : uint8_t { Interpreter, Block, Jit };
+enum class CacheWritePolicy : uint8_t { WriteBack, WriteThrough };
+enum class OutputBackpressure : uint8_t { Drop, Block };
+enum class DebugLevel : uint8_t { None, Minimal, Normal, Verbose, Debug };
+
+// Validated configuration converted to typed values once, after loading.
+// Integers and hex values are numbers, booleans 0 or 1 and enums the
+// index of their value in the schema, so reads are a single array load.
+// Instances are immutable and shared between the VPUs built from them;
+// changing a parameter produces a new one.
+class ResolvedConfig {
+public:
+    static std::shared_ptr<const ResolvedConfig> resolve(const FiscConfigParser& parser, std::string& error);
+    std::shared_ptr<const ResolvedConfig> withParameter(ConfigParam param, const std::string& value,
+                                                        std::string& error) const;
+
+    // Reads an .fxml text file, or an .fxmlc written by saveCompiled(). A
+    // compiled file from another format version or schema is passed over
+    // for the .fxml of the same name beside it.
+    static std::shared_ptr<const ResolvedConfig> load(const std::string& path, std::string& error);
+
+    // Binary form: a header with format version and schema hash, the typed
+    // values in schema order, their texts and a CRC-32 of all of it
+    bool saveCompiled(const std::string& path, std::string& error) const;
+
+    // Parses FXml text in place, reporting every bad line instead of
+    // stopping at the first. Parameters the text leaves out keep their
+    // defaults; lines records where each one was set (0 when defaulted).
+    struct LineError {
+        uint32_t line;
+        std::string message;
+    };
+    static std::shared_ptr<const ResolvedConfig> parse(std::string_view text, std::vector<LineError>& errors,
+                                                       uint32_t (&lines)[CONFIG_PARAM_COUNT]);
+
+    static const char* name(ConfigParam param);
+    static bool lookup(const std::string& name, ConfigParam& param);
+
+    uint64_t integer(ConfigParam param) const { return values[index(param)]; }
+    bool flag(ConfigParam param) const { return values[index(param)] != 0; }
+    uint32_t ordinal(ConfigParam param) const { return static_cast<uint32_t>(values[index(param)]); }
+    template <typename Enum>
+    Enum choice(ConfigParam param) const { return static_cast<Enum>(values[index(param)]); }
+
+    // Value as written; the only view of STRING parameters
+    const std::string& text(ConfigParam param) const { return texts[index(param)]; }
+
+private:
+    uint64_t values[CONFIG_PARAM_COUNT];
+    std::string texts[CONFIG_PARAM_COUNT];
+
+    static size_t index(ConfigParam param) { return static_cast<size_t>(param); }
+    bool assign(ConfigParam param, std::string_view value, std::string& error);
+    enum class CompiledStatus : uint8_t { Loaded, Stale, Corrupt };
+    CompiledStatus loadCompiled(const std::vector<uint8_t>& bytes);
+};
+
+#endif // RESOLVED_CONFIG_HPP
@@ -1,29 +1,69 @@
 #include "MiniBiosShell.hpp"
 #include <iostream>
 #include <sstream>
+#include <chrono>
+#include <cstdio>
 
-MiniBiosShell::MiniBiosShell(const FiscConfigParser& config)
-    : running(false) {
-    vpu = std::make_unique<FiscVpu>(config);
-    vpu->setOutputCallback([this](const std::string& output) {
-        handleVpuOutput(output);
+MiniBiosShell::MiniBiosShell(std::shared_ptr<const ResolvedConfig> config)
+    : running(false), draining(true), reportedDrops(0) {
+    auto policy = config->choice<OutputBackpressure>(ConfigParam::OUTPUT_BACKPRESSURE) == OutputBackpressure::Block
+        ? OutputChannel::Backpressure::Block : OutputChannel::Backpressure::Drop;
+    output = std::make_shared<OutputChannel>(256, policy);
+    vpu = std::make_unique<FiscVpu>(std::move(config));
+    vpu->setOutputChannel(output);
+    
+    outputThread = std::thread([this]() {
+        while (draining) {
+            drainOutput();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
     });
 }
 
+MiniBiosShell::~MiniBiosShell() {
+    // A runner still blocked on a full channel drops its output instead
+    output->close();
+    draining = false;
+    outputThread.join();
+    drainOutput();
+}
+
 void MiniBiosShell::run() {
     running = true;
     std::cout << "FISC-V MiniBIOS Shell\n";
     std::cout << "Type 'help' for available commands\n";
     
     while (running) {
-        std::cout << "minibios> ";
+        {
+            std::lock_guard<std::mutex> lock(consoleMutex);
+            std::cout << "minibios> " << std::flush;
+        }
         std::string input;
-        std::getline(std::cin, input);
-        processCommand(input);
+        if (!std::getline(std::cin, input)) {
+            break;
+        }
+        {
+            std::unique_lock<std::mutex> lock(consoleMutex);
+            processCommand(input, lock);
+        }
+        // Show what the command triggered before the next prompt
+        drainOutput();
+    }
+}
+
+void MiniBiosShell::drainOutput() {
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    output->drain([this](std::string_view message) {
+        handleVpuOutput(message);
+    });
+    uint64_t dropped = output->dropped();
+    if (dropped != reportedDrops) {
+        std::cout << "[VPU] " << dropped - reportedDrops << " messages dropped\n";
+        reportedDrops = dropped;
     }
 }
 
-void MiniBiosShell::processCommand(const std::string& cmd) {
+void MiniBiosShell::processCommand(const std::string& cmd, std::unique_lock<std::mutex>& console) {
     std::istringstream iss(cmd);
     std::string command;
     iss >> command;
@@ -32,18 +72,24 @@ void MiniBiosShell::processCommand(const std::string& cmd) {
         printHelp();
     }
     else if (command == "show" && iss >> command && command == "config") {
-        auto params = vpu->getConfig().getAllParameters();
+        auto config = vpu->getConfig();
         std::cout << "Current configuration:\n";
-        for (const auto& [param, value] : params) {
-            std::cout << param << " = " << value << "\n";
+        for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+            auto param = static_cast<ConfigParam>(i);
+            std::cout << ResolvedConfig::name(param) << " = " << config->text(param) << "\n";
         }
     }
     else if (command == "set") {
         std::string param, value;
         if (iss >> param >> value) {
-            if (vpu->setConfigParameter(param, value)) {
-                std::cout << "Parameter updated successfully\n";
-            } else {
+            // Hot parameters reach a running VPU at its next quantum; the
+            // VPU reports why it refuses the others
+            const auto* def = FiscConfigSchema::find(param);
+            const bool live = vpu->isRunning();
+            if (unlocked(console, [&]() { return vpu->setConfigParameter(param, value); })) {
+                std::cout << (live ? "Parameter published, the VPU applies it at its next quantum\n"
+                                   : "Parameter updated successfully\n");
+            } else if (!live || !def || def->hotReload) {
                 std::cout << "Invalid parameter or value\n";
             }
         }
@@ -51,8 +97,10 @@ void MiniBiosShell::processCommand(const std::string& cmd) {
     else if (command == "info") {
         std::string param;
         if (iss >> param) {
+            const auto* def = FiscConfigSchema::find(param);
             std::cout << "Parameter: " << param << "\n"
-                     << "Description: " << FiscConfigParser::getParameterDescription(param) << "\n";
+                     << "Description: " << FiscConfigParser::getParameterDescription(param) << "\n"
+                     << "Changes while running: " << (def && def->hotReload ? "yes" : "no") << "\n";
             auto enumValues = FiscConfigParser::getEnumValues(param);
             if (!enumValues.empty()) {
                 std::cout << "Possible values: ";
@@ -72,7 +120,7 @@ void MiniBiosShell::processCommand(const std::string& cmd) {
     }
     else if (command == "start") {
         if (!vpu->isRunning()) {
-            if (vpu->initialize() && vpu->start()) {
+            if (unlocked(console, [this]() { return vpu->initialize() && vpu->start(); })) {
                 std::cout << "VPU started\n";
             } else {
                 std::cout << "Failed to start VPU\n";
@@ -83,15 +131,135 @@ void MiniBiosShell::processCommand(const std::string& cmd) {
     }
     else if (command == "stop") {
         if (vpu->isRunning()) {
-            vpu->stop();
+            unlocked(console, [this]() { vpu->stop(); });
             std::cout << "VPU stopped\n";
         } else {
             std::cout << "VPU is not running\n";
         }
     }
+    else if (command == "pause") {
+        if (unlocked(console, [this]() { return vpu->pause(); })) {
+            std::printf("VPU paused at 0x%08llx\n", static_cast<unsigned long long>(vpu->getProgramCounter()));
+        } else {
+            std::cout << "VPU is not running\n";
+        }
+    }
+    else if (command == "resume") {
+        if (!unlocked(console, [this]() { return vpu->resume(); })) {
+            std::cout << "VPU is not paused\n";
+        }
+    }
+    else if (command == "step") {
+        uint64_t count = 1;
+        std::string arg;
+        if (iss >> arg) {
+            try {
+                count = std::stoull(arg, nullptr, 0);
+            } catch (...) {
+                count = 0;
+            }
+        }
+        if (count == 0) {
+            std::cout << "Usage: step [n]\n";
+        } else if (!unlocked(console, [&]() { return vpu->step(count); })) {
+            std::cout << "VPU must be paused to step\n";
+        } else if (vpu->getState() == FiscVpu::RunState::Stopped) {
+            std::cout << "VPU stopped while stepping\n";
+        }
+    }
+    else if (command == "until") {
+        std::string arg;
+        uint64_t address = 0;
+        bool valid = static_cast<bool>(iss >> arg);
+        if (valid) {
+            try {
+                address = std::stoull(arg, nullptr, 16);
+            } catch (...) {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            std::cout << "Usage: until <hex address>\n";
+        } else if (!unlocked(console, [&]() { return vpu->runUntil(address); })) {
+            std::cout << "VPU is not running\n";
+        }
+    }
+    else if (command == "stats") {
+        auto stats = vpu->getExecutionStats();
+        std::cout << "Instructions retired: " << stats.instructions << "\n"
+                  << "Host time:            " << stats.hostSeconds << " s\n"
+                  << "Achieved rate:        " << stats.achievedMips << " MIPS\n";
+        if (stats.throttled) {
+            std::cout << "Target rate:          " << stats.targetIps / 1e6 << " MIPS\n"
+                      << "Throttle accuracy:    " << stats.throttleAccuracy << " %\n";
+        } else {
+            std::cout << "Throttling:           off (unthrottled)\n";
+        }
+        std::cout << "Guest RAM resident:   " << vpu->getResidentMemory() / 1024 << " KiB of "
+                  << vpu->getMemorySize() / 1024 << " KiB\n";
+    }
+    else if (command == "perf") {
+        static const char* classNames[FiscVpu::OP_CLASS_COUNT] = {
+            "alu", "load", "store", "branch", "jump", "system"
+        };
+        auto perf = vpu->getPerfCounters();
+        std::string format;
+        if (iss >> format && format == "json") {
+            std::cout << "{\"instructions\":" << perf.instructions
+                      << ",\"cycles\":" << perf.cycles
+                      << ",\"loads\":" << perf.loads()
+                      << ",\"stores\":" << perf.stores()
+                      << ",\"taken_branches\":" << perf.takenBranches
+                      << ",\"traps\":" << perf.traps
+                      << ",\"itlb_misses\":" << perf.itlbMisses
+                      << ",\"dtlb_misses\":" << perf.dtlbMisses
+                      << ",\"op_classes\":{";
+            for (size_t i = 0; i < FiscVpu::OP_CLASS_COUNT; ++i) {
+                std::cout << (i ? "," : "") << "\"" << classNames[i] << "\":" << perf.opClasses[i];
+            }
+            std::cout << "}}\n";
+        } else {
+            std::cout << "Instructions:    " << perf.instructions << "\n"
+                      << "Cycles:          " << perf.cycles << "\n"
+                      << "Loads:           " << perf.loads() << "\n"
+                      << "Stores:          " << perf.stores() << "\n"
+                      << "Taken branches:  " << perf.takenBranches << "\n"
+                      << "Traps:           " << perf.traps << "\n";
+            if (vpu->hasPagingMmu()) {
+                std::cout << "ITLB:            " << perf.instructions - perf.itlbMisses << " hits, "
+                          << perf.itlbMisses << " misses\n"
+                          << "DTLB:            " << perf.loads() + perf.stores() - perf.dtlbMisses << " hits, "
+                          << perf.dtlbMisses << " misses\n";
+            }
+            std::cout << "By class:";
+            for (size_t i = 0; i < FiscVpu::OP_CLASS_COUNT; ++i) {
+                std::cout << " " << classNames[i] << "=" << perf.opClasses[i];
+            }
+            std::cout << "\n";
+        }
+    }
+    else if (command == "cache") {
+        FiscVpu::CacheStats icache, dcache;
+        if (!vpu->getCacheStats(icache, dcache)) {
+            std::cout << "Cache simulation is off (set CACHE_SIMULATION true)\n";
+        } else {
+            auto print = [](const char* name, const FiscVpu::CacheStats& s) {
+                uint64_t accesses = s.hits + s.misses;
+                std::cout << name << ": " << s.reads << " reads, " << s.writes << " writes, "
+                          << s.hits << " hits, " << s.misses << " misses, "
+                          << s.evictions << " evictions, " << s.writebacks << " writebacks";
+                if (accesses) {
+                    std::cout << " (" << 100.0 * s.hits / accesses << " % hit rate)";
+                }
+                std::cout << "\n";
+            };
+            print("I-cache", icache);
+            print("D-cache", dcache);
+        }
+    }
     else if (command == "exit") {
         if (vpu->isRunning()) {
-            vpu->stop();
+            unlocked(console, [this]() { vpu->stop(); });
         }
         running = false;
     }
@@ -104,14 +272,29 @@ void MiniBiosShell::printHelp() {
     std::cout << "Available commands:\n"
               << "  start           - Start the VPU\n"
               << "  stop            - Stop the VPU\n"
+              << "  pause           - Pause the VPU at the end of its quantum\n"
+              << "  resume          - Resume a paused VPU\n"
+              << "  step [n]        - Execute n instructions (default 1) on a paused VPU\n"
+              << "  until <addr>    - Run until pc reaches a hex address, then pause\n"
               << "  show config     - Display current configuration\n"
               << "  set <param> <value> - Set configuration parameter\n"
+              << "                  Applied live while running:";
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+        const auto& def = FiscConfigSchema::get(static_cast<ConfigParam>(i));
+        if (def.hotReload) {
+            std::cout << " " << def.name;
+        }
+    }
+    std::cout << "\n"
               << "  info <param>    - Show parameter information\n"
               << "  list params     - List all available parameters\n"
+              << "  stats           - Show executed instructions, MIPS, throttle accuracy and resident RAM\n"
+              << "  perf [json]     - Show guest performance counters\n"
+              << "  cache           - Show L1 cache hit/miss/eviction counters\n"
               << "  help            - Show this help message\n"
               << "  exit            - Exit the shell\n";
 }
 
-void MiniBiosShell::handleVpuOutput(const std::string& output) {
+void MiniBiosShell::handleVpuOutput(std::string_view output) {
     std::cout << "[VPU] " << output << "\n";
 } 
\ No newline at end of file
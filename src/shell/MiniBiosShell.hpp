@@ -3,21 +3,48 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include "../vpu/FiscVpu.hpp"
+#include "../vpu/OutputChannel.hpp"
 #include "../config/FiscConfigParser.hpp"
+#include "../config/ResolvedConfig.hpp"
 
 class MiniBiosShell {
 public:
-    MiniBiosShell(const FiscConfigParser& config);
+    MiniBiosShell(std::shared_ptr<const ResolvedConfig> config);
+    ~MiniBiosShell();
     void run();
     
 private:
     std::unique_ptr<FiscVpu> vpu;
     bool running;
     
-    void processCommand(const std::string& cmd);
+    // VPU output is queued and printed by a drain thread; consoleMutex
+    // keeps it from interleaving with the prompt and command output
+    std::shared_ptr<OutputChannel> output;
+    std::mutex consoleMutex;
+    std::thread outputThread;
+    std::atomic<bool> draining;
+    uint64_t reportedDrops;
+    
+    // Called with console held; it is released around FiscVpu control
+    // calls, which can wait on a runner that is itself waiting for the
+    // drain thread to make room in a Block-mode channel
+    void processCommand(const std::string& cmd, std::unique_lock<std::mutex>& console);
+    template <typename Call>
+    static auto unlocked(std::unique_lock<std::mutex>& console, Call&& call) {
+        struct Relock {
+            std::unique_lock<std::mutex>& lock;
+            ~Relock() { lock.lock(); }
+        } relock{console};
+        console.unlock();
+        return call();
+    }
     void printHelp();
-    void handleVpuOutput(const std::string& output);
+    void drainOutput();
+    void handleVpuOutput(std::string_view output);
 };
 
 #endif // MINI_BIOS_SHELL_HPP 
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "CacheModel.hpp"
+
+namespace {
+
+bool isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+uint32_t log2Of(uint32_t value) {
+    uint32_t shift = 0;
+    while ((1u << shift) < value) {
+        ++shift;
+    }
+    return shift;
+}
+
+} // namespace
+
+bool CacheModel::checkGeometry(uint32_t sizeBytes, uint32_t lineBytes, uint32_t wayCount, std::string& error) {
+    if (!isPowerOfTwo(lineBytes) || !isPowerOfTwo(sizeBytes) || sizeBytes < lineBytes) {
+        error = "cache size must be a power of two no smaller than the line size";
+        return false;
+    }
+    if (wayCount > sizeBytes / lineBytes) {
+        error = "associativity exceeds the number of cache lines";
+        return false;
+    }
+    return true;
+}
+
+bool CacheModel::configure(uint32_t sizeBytes, uint32_t lineBytes, uint32_t wayCount,
+                           WritePolicy writePolicy, std::string& error) {
+    if (!checkGeometry(sizeBytes, lineBytes, wayCount, error)) {
+        return false;
+    }
+    const uint32_t lines = sizeBytes / lineBytes;
+    if (wayCount == 0) {
+        wayCount = lines;
+    }
+    
+    lineShift = log2Of(lineBytes);
+    ways = wayCount;
+    sets = lines / wayCount;
+    policy = writePolicy;
+    reset();
+    return true;
+}
+
+void CacheModel::reset() {
+    const size_t entries = static_cast<size_t>(sets) * ways;
+    tags.assign(entries, INVALID_TAG);
+    lastUse.assign(entries, 0);
+    dirty.assign(entries, 0);
+    clock = 0;
+    stats = Stats{};
+}
+
+bool CacheModel::accessLine(uint64_t line, bool isWrite) {
+    const size_t base = static_cast<size_t>(line & (sets - 1)) * ways;
+    ++clock;
+    if (isWrite) {
+        ++stats.writes;
+    } else {
+        ++stats.reads;
+    }
+    
+    // The full line number serves as the tag; the set bits are redundant
+    // but keep the compare a single 64-bit equality
+    const uint64_t* setTags = &tags[base];
+    for (uint32_t way = 0; way < ways; ++way) {
+        if (setTags[way] == line) {
+            ++stats.hits;
+            lastUse[base + way] = clock;
+            if (isWrite && policy == WritePolicy::WriteBack) {
+                dirty[base + way] = 1;
+            }
+            return true;
+        }
+    }
+    
+    ++stats.misses;
+    if (isWrite && policy == WritePolicy::WriteThrough) {
+        return false;  // No-write-allocate
+    }
+    
+    // Fill an invalid way if there is one, otherwise evict the LRU way
+    uint32_t victim = 0;
+    for (uint32_t way = 0; way < ways; ++way) {
+        if (setTags[way] == INVALID_TAG) {
+            victim = way;
+            break;
+        }
+        if (lastUse[base + way] < lastUse[base + victim]) {
+            victim = way;
+        }
+    }
+    if (tags[base + victim] != INVALID_TAG) {
+        ++stats.evictions;
+        if (dirty[base + victim]) {
+            ++stats.writebacks;
+        }
+    }
+    tags[base + victim] = line;
+    lastUse[base + victim] = clock;
+    dirty[base + victim] = isWrite && policy == WritePolicy::WriteBack;
+    return false;
+}
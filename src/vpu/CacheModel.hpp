@@ -0,0 +1,68 @@
+#ifndef CACHE_MODEL_HPP
+#define CACHE_MODEL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Functional L1 cache model: tracks which lines would be resident and
+// counts hits, misses and evictions, but never holds data itself. Tags,
+// dirty bits and LRU stamps live in separate flat arrays (one entry per
+// way, sets stored contiguously) so a lookup touches a few cache lines.
+class CacheModel {
+public:
+    enum class WritePolicy {
+        WriteBack,     // Write-allocate, dirty lines written back on eviction
+        WriteThrough   // No-write-allocate, every store goes to memory
+    };
+    
+    struct Stats {
+        uint64_t reads;
+        uint64_t writes;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t writebacks;
+    };
+    
+    // ways == 0 selects a fully associative cache
+    bool configure(uint32_t sizeBytes, uint32_t lineBytes, uint32_t ways, WritePolicy policy,
+                   std::string& error);
+    static bool checkGeometry(uint32_t sizeBytes, uint32_t lineBytes, uint32_t ways, std::string& error);
+    
+    // Returns true on a hit; accesses straddling two lines touch both
+    bool access(uint64_t addr, uint32_t size, bool isWrite) {
+        uint64_t first = addr >> lineShift;
+        uint64_t last = (addr + size - 1) >> lineShift;
+        bool hit = accessLine(first, isWrite);
+        if (last != first) {
+            hit = accessLine(last, isWrite) && hit;
+        }
+        return hit;
+    }
+    
+    const Stats& getStats() const { return stats; }
+    void reset();
+    
+    uint32_t getSets() const { return sets; }
+    uint32_t getWays() const { return ways; }
+    uint32_t getLineSize() const { return 1u << lineShift; }
+
+private:
+    static constexpr uint64_t INVALID_TAG = ~uint64_t(0);
+    
+    uint32_t lineShift = 6;
+    uint32_t sets = 0;
+    uint32_t ways = 0;
+    WritePolicy policy = WritePolicy::WriteBack;
+    uint64_t clock = 0;
+    
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> lastUse;
+    std::vector<uint8_t> dirty;
+    Stats stats{};
+    
+    bool accessLine(uint64_t line, bool isWrite);
+};
+
+#endif // CACHE_MODEL_HPP
@@ -0,0 +1,30 @@
+#ifndef CPU_CORE_HPP
+#define CPU_CORE_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Instruction-set core behind a FiscVpu. The VPU resolves ARCHITECTURE to
+// one core in initialize(); from then on execution costs one virtual call
+// per quantum, and each core's inner loop runs over its own register file.
+// Cores keep FiscVpu::pc at the linear address of the next instruction
+// whenever they return.
+class CpuCore {
+public:
+    virtual ~CpuCore() = default;
+
+    // Reset state with execution starting at entry
+    virtual void reset(uint64_t entry) = 0;
+
+    // Executes up to maxInstructions, returning early once the guest halts
+    virtual uint64_t run(uint64_t maxInstructions) = 0;
+
+    // Exactly one instruction, bypassing any translated code
+    virtual void step() = 0;
+
+    // Register file as raw bytes for snapshots; restore rejects a mismatch
+    virtual std::vector<uint8_t> saveState() const = 0;
+    virtual bool restoreState(const std::vector<uint8_t>& saved) = 0;
+};
+
+#endif // CPU_CORE_HPP
@@ -0,0 +1,208 @@
+#include "FiscBlockEngine.hpp"
+#include "CacheModel.hpp"
+#include <algorithm>
+#include <iterator>
+
+FiscBlockEngine::FiscBlockEngine(FiscVpu& vpu, bool enableJit)
+    : vpu(vpu), generation(1), jitContext{} {
+    codePages.resize((vpu.memory.size() + FiscVpu::DECODE_PAGE_SIZE - 1) >> FiscVpu::DECODE_PAGE_SHIFT, 0);
+    for (size_t page = 0; page < codePages.size() && page < vpu.decodeCache.size(); ++page) {
+        if (vpu.decodeCache[page]) {
+            codePages[page] = PAGE_DECODED;
+        }
+    }
+    
+    if (enableJit) {
+        jit = std::make_unique<FiscJitCompiler>();
+        if (!jit->initialize(FiscJitCompiler::DEFAULT_CACHE_SIZE)) {
+            jit.reset();
+        }
+        jitContext.memory = vpu.memory.data();
+        jitContext.memorySize = vpu.memory.size();
+        jitContext.codePages = codePages.data();
+    }
+}
+
+uint64_t FiscBlockEngine::run(uint64_t maxInstructions) {
+    uint64_t count = 0;
+    Block* block = nullptr;
+    
+    while (count < maxInstructions && vpu.running) {
+        const uint64_t pc = vpu.pc & vpu.addressMask;
+        block = block ? follow(block, pc) : lookup(pc);
+        if (!block) {
+            break;
+        }
+        
+        if (jit) {
+            if (block->native && block->nativeEpoch == jit->epoch()) {
+                count += runNative(block);
+                if (vpu.blockInterrupted) {
+                    retired.clear();
+                    block = nullptr;
+                }
+                continue;
+            }
+            if (!block->jitRejected && ++block->heat >= JIT_THRESHOLD) {
+                compile(block);
+            }
+        }
+        
+        // Straight-line dispatch over the pre-linked handlers; only a trap,
+        // stop or code invalidation cuts a block short
+        vpu.blockInterrupted = false;
+        const FiscVpu::DecodedInstruction* insn = block->insns.data();
+        const FiscVpu::DecodedInstruction* end = insn + block->insns.size();
+        if (vpu.instructionCache) {
+            do {
+                vpu.instructionCache->access(vpu.pc & vpu.addressMask, 4, false);
+                insn->handler(vpu, *insn);
+                ++insn;
+            } while (insn != end && !vpu.blockInterrupted);
+        } else {
+            do {
+                insn->handler(vpu, *insn);
+                ++insn;
+            } while (insn != end && !vpu.blockInterrupted);
+        }
+        countRetired(block, insn - block->insns.data());
+        count += insn - block->insns.data();
+        
+        if (vpu.blockInterrupted) {
+            retired.clear();
+            block = nullptr;
+        }
+    }
+    return count;
+}
+
+void FiscBlockEngine::compile(Block* block) {
+    block->heat = 0;
+    // Only RV32 guests with a full 32-bit bus reach the JIT
+    block->native = jit->compile(static_cast<uint32_t>(block->startPc), &vpu.memory[block->startPc],
+                                 block->insns.size());
+    block->nativeEpoch = jit->epoch();
+    block->jitRejected = block->native == nullptr;
+}
+
+uint64_t FiscBlockEngine::runNative(Block* block) {
+    vpu.blockInterrupted = false;
+    block->native(vpu.registers, &jitContext);
+    vpu.pc = jitContext.exitPc;
+    countRetired(block, jitContext.retired);
+    
+    switch (jitContext.exitReason) {
+        case FiscJitCompiler::EXIT_NORMAL:
+            // Host code has no counters; a branch went its own way if it did not fall through
+            if (block->insns.back().opClass == FiscVpu::OpClass::Branch &&
+                vpu.pc != block->startPc + 4 * block->insns.size()) {
+                ++vpu.perf.takenBranches;
+            }
+            break;
+        case FiscJitCompiler::EXIT_FAULT: {
+            // Let the interpreter raise the precise trap
+            const auto& insn = block->insns[jitContext.retired];
+            insn.handler(vpu, insn);
+            break;
+        }
+        case FiscJitCompiler::EXIT_CODE_WRITE:
+            vpu.invalidateDecoded(jitContext.storeAddress, jitContext.storeSize);
+            break;
+    }
+    return jitContext.retired;
+}
+
+void FiscBlockEngine::countRetired(const Block* block, size_t executed) {
+    if (executed == block->insns.size()) {
+        for (size_t i = 0; i < FiscVpu::OP_CLASS_COUNT; ++i) {
+            vpu.perf.opClasses[i] += block->opClasses[i];
+        }
+        return;
+    }
+    for (size_t i = 0; i < executed; ++i) {
+        vpu.countOpClass(block->insns[i].opClass);
+    }
+}
+
+FiscBlockEngine::Block* FiscBlockEngine::follow(Block* from, uint64_t pc) {
+    for (auto& link : from->links) {
+        if (link.pc == pc && link.generation == generation) {
+            return link.block;
+        }
+    }
+    
+    Block* next = lookup(pc);
+    if (next) {
+        Link& link = from->links[from->nextLink];
+        link = Link{pc, generation, next};
+        from->nextLink ^= 1;
+    }
+    return next;
+}
+
+FiscBlockEngine::Block* FiscBlockEngine::lookup(uint64_t pc) {
+    auto it = blocks.find(pc);
+    if (it != blocks.end()) {
+        return it->second.get();
+    }
+    return translate(pc);
+}
+
+FiscBlockEngine::Block* FiscBlockEngine::translate(uint64_t pc) {
+    const auto& memory = vpu.memory;
+    if (!vpu.inMemory(pc, 4) || (pc & 0x3)) {
+        vpu.halt();
+        return nullptr;
+    }
+    
+    // Blocks never cross a page so invalidation is per page
+    auto block = std::make_unique<Block>();
+    std::fill(std::begin(block->opClasses), std::end(block->opClasses), 0);
+    const uint64_t page = pc >> FiscVpu::DECODE_PAGE_SHIFT;
+    uint64_t addr = pc;
+    while (block->insns.size() < MAX_BLOCK_LENGTH && vpu.inMemory(addr, 4) &&
+           (addr >> FiscVpu::DECODE_PAGE_SHIFT) == page) {
+        FiscVpu::DecodedInstruction insn = vpu.decode(InstructionBus::load<uint32_t>(&memory[addr]));
+        block->insns.push_back(insn);
+        ++block->opClasses[static_cast<size_t>(insn.opClass)];
+        addr += 4;
+        
+        auto cls = insn.opClass;
+        if (cls == FiscVpu::OpClass::Branch || cls == FiscVpu::OpClass::Jump ||
+            cls == FiscVpu::OpClass::System) {
+            break;
+        }
+    }
+    block->startPc = pc;
+    block->links[0] = block->links[1] = Link{0, 0, nullptr};
+    block->nextLink = 0;
+    block->native = nullptr;
+    block->nativeEpoch = 0;
+    block->heat = 0;
+    block->jitRejected = false;
+    
+    codePages[page] |= PAGE_BLOCKS;
+    pageBlocks[page].push_back(pc);
+    Block* result = block.get();
+    blocks[pc] = std::move(block);
+    return result;
+}
+
+void FiscBlockEngine::invalidatePage(uint64_t page) {
+    auto it = pageBlocks.find(page);
+    if (it != pageBlocks.end()) {
+        for (uint64_t pc : it->second) {
+            auto blockIt = blocks.find(pc);
+            if (blockIt != blocks.end()) {
+                retired.push_back(std::move(blockIt->second));
+                blocks.erase(blockIt);
+            }
+        }
+        pageBlocks.erase(it);
+    }
+    codePages[page] &= ~PAGE_BLOCKS;
+    
+    // Bumping the generation drops every chain link into the page at once
+    ++generation;
+    vpu.blockInterrupted = true;
+}
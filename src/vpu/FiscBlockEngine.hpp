@@ -0,0 +1,77 @@
+#ifndef FISC_BLOCK_ENGINE_HPP
+#define FISC_BLOCK_ENGINE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "FiscVpu.hpp"
+#include "FiscJitCompiler.hpp"
+
+// Basic-block execution engine. Guest code is decoded once into blocks of
+// pre-linked instruction handlers ending at the first control transfer,
+// and successor blocks are chained directly so hot loops skip the lookup.
+// With the JIT enabled, hot blocks are additionally translated to host code.
+class FiscBlockEngine {
+public:
+    FiscBlockEngine(FiscVpu& vpu, bool enableJit);
+    
+    bool hasJit() const { return jit != nullptr; }
+    
+    uint64_t run(uint64_t maxInstructions);
+    
+    // Code page tracking for self-modifying code. Pages the interpreter has
+    // decoded are watched too, so native stores to them leave the JIT and
+    // reach invalidateDecoded().
+    bool isCodePage(uint64_t page) const { return (codePages[page] & PAGE_BLOCKS) != 0; }
+    void watchDecodedPage(uint64_t page) { codePages[page] |= PAGE_DECODED; }
+    void invalidatePage(uint64_t page);
+
+private:
+    static constexpr size_t MAX_BLOCK_LENGTH = 64;
+    static constexpr uint32_t JIT_THRESHOLD = 16;  // Executions before a block is translated
+    
+    // codePages flags; generated code exits on a store to a page with either
+    static constexpr uint8_t PAGE_BLOCKS = 1;   // Holds translated blocks
+    static constexpr uint8_t PAGE_DECODED = 2;  // Has decode cache entries
+    
+    struct Block;
+    // Blocks are keyed by physical address: pc wrapped to the address bus
+    struct Link {
+        uint64_t pc;
+        uint64_t generation;  // Link is stale once the engine generation moves on
+        Block* block;
+    };
+    struct Block {
+        uint64_t startPc;
+        std::vector<FiscVpu::DecodedInstruction> insns;
+        Link links[2];
+        uint8_t nextLink;
+        uint16_t opClasses[FiscVpu::OP_CLASS_COUNT];  // Counter deltas for a full run
+        
+        // Host translation, valid while nativeEpoch matches the code cache
+        FiscJitCompiler::BlockFunction native;
+        uint64_t nativeEpoch;
+        uint32_t heat;
+        bool jitRejected;
+    };
+    
+    FiscVpu& vpu;
+    std::unordered_map<uint64_t, std::unique_ptr<Block>> blocks;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> pageBlocks;
+    std::vector<uint8_t> codePages;
+    std::vector<std::unique_ptr<Block>> retired;  // Freed once no longer executing
+    uint64_t generation;
+    
+    std::unique_ptr<FiscJitCompiler> jit;
+    FiscJitCompiler::Context jitContext;
+    
+    Block* lookup(uint64_t pc);
+    Block* translate(uint64_t pc);
+    Block* follow(Block* from, uint64_t pc);
+    void compile(Block* block);
+    uint64_t runNative(Block* block);
+    void countRetired(const Block* block, size_t executed);
+};
+
+#endif // FISC_BLOCK_ENGINE_HPP
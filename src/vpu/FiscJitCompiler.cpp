@@ -0,0 +1,329 @@
+#include "FiscJitCompiler.hpp"
+#include "GuestBus.hpp"
+#include <cstring>
+#include <initializer_list>
+
+#if FISC_JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int32_t signExtend(uint32_t value, int bits) {
+    const uint32_t mask = 1u << (bits - 1);
+    return static_cast<int32_t>((value ^ mask) - mask);
+}
+
+// Minimal x86-64 encoder for the handful of forms the translator emits.
+// Generated code receives the guest register file in rdi and the Context
+// in rsi; r8/r9/r10 cache guest memory base, size and code page flags.
+class X86Emitter {
+public:
+    enum Reg : uint8_t { EAX = 0, ECX = 1, EDX = 2, RSI = 6, RDI = 7 };
+
+    explicit X86Emitter(std::vector<uint8_t>& out) : out(out) {}
+
+    void byte(uint8_t b) { out.push_back(b); }
+    void bytes(std::initializer_list<uint8_t> bs) { out.insert(out.end(), bs); }
+    void dword(uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+    size_t size() const { return out.size(); }
+
+    // mov reg, [rdi + index*4] / mov [rdi + index*4], reg / mov dword [rdi + index*4], imm
+    void loadGuest(Reg r, unsigned index) { bytes({0x8B, static_cast<uint8_t>(0x80 | (r << 3) | RDI)}); dword(index * 4); }
+    void storeGuest(unsigned index, Reg r) { bytes({0x89, static_cast<uint8_t>(0x80 | (r << 3) | RDI)}); dword(index * 4); }
+    void storeGuestImm(unsigned index, uint32_t v) { bytes({0xC7, 0x87}); dword(index * 4); dword(v); }
+
+    // mov dword [rsi + offset], imm / mov [rsi + offset], eax
+    void storeContextImm(size_t offset, uint32_t v) { bytes({0xC7, 0x86}); dword(static_cast<uint32_t>(offset)); dword(v); }
+    void storeContextEax(size_t offset) { bytes({0x89, 0x86}); dword(static_cast<uint32_t>(offset)); }
+
+    // eax <op>= imm32 using the short accumulator forms
+    void aluEaxImm(uint8_t opcode, uint32_t v) { byte(opcode); dword(v); }
+
+    // setcc al; movzx eax, al
+    void setEax(uint8_t cc) { bytes({0x0F, static_cast<uint8_t>(0x90 | cc), 0xC0, 0x0F, 0xB6, 0xC0}); }
+
+    // jcc rel32 / jmp rel32 with the displacement patched later
+    size_t jcc(uint8_t cc) { bytes({0x0F, static_cast<uint8_t>(0x80 | cc)}); dword(0); return out.size() - 4; }
+    void patch(size_t at, size_t target) {
+        uint32_t rel = static_cast<uint32_t>(target - (at + 4));
+        std::memcpy(&out[at], &rel, 4);
+    }
+
+private:
+    std::vector<uint8_t>& out;
+};
+
+// x86 condition codes
+enum Cond : uint8_t { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_L = 0xC, CC_GE = 0xD };
+
+} // namespace
+
+FiscJitCompiler::FiscJitCompiler()
+    : cache(nullptr), cacheSize(0), cacheUsed(0), cacheEpoch(1) {}
+
+FiscJitCompiler::~FiscJitCompiler() {
+#if FISC_JIT_AVAILABLE
+    if (cache) {
+        munmap(cache, cacheSize);
+    }
+#endif
+}
+
+bool FiscJitCompiler::initialize(size_t size) {
+#if FISC_JIT_AVAILABLE
+    // Never writable and executable at once: compile() opens the pages it
+    // emits into for writing and seals them again before returning
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    cache = static_cast<uint8_t*>(mapping);
+    cacheSize = size;
+    cacheUsed = 0;
+    return true;
+#else
+    (void)size;
+    return false;
+#endif
+}
+
+FiscJitCompiler::BlockFunction FiscJitCompiler::compile(uint32_t pc, const uint8_t* code, size_t count) {
+    if (!cache) {
+        return nullptr;
+    }
+    std::vector<uint8_t> out;
+    if (!translate(pc, code, count, out) || out.size() > cacheSize) {
+        return nullptr;
+    }
+
+    // Eviction policy: flush the whole cache when it fills up. Blocks keep
+    // the epoch they were translated in, so stale entry points die at once.
+    if (cacheUsed + out.size() > cacheSize) {
+        cacheUsed = 0;
+        ++cacheEpoch;
+    }
+    uint8_t* entry = cache + cacheUsed;
+#if FISC_JIT_AVAILABLE
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = reinterpret_cast<uintptr_t>(entry) & ~(pageSize - 1);
+    const size_t span = reinterpret_cast<uintptr_t>(entry) + out.size() - first;
+    void* pages = reinterpret_cast<void*>(first);
+    if (mprotect(pages, span, PROT_READ | PROT_WRITE) != 0) {
+        return nullptr;
+    }
+    std::memcpy(entry, out.data(), out.size());
+    if (mprotect(pages, span, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+#endif
+    cacheUsed += (out.size() + 15) & ~size_t(15);
+    return reinterpret_cast<BlockFunction>(entry);
+}
+
+bool FiscJitCompiler::translate(uint32_t pc, const uint8_t* code, size_t count, std::vector<uint8_t>& out) {
+    using E = X86Emitter;
+    X86Emitter x(out);
+
+    struct Exit {
+        size_t patchAt;
+        uint32_t pc;
+        uint32_t retired;
+        uint32_t reason;
+        uint32_t storeSize;
+    };
+    std::vector<Exit> exits;
+
+    auto emitExit = [&](uint32_t exitPc, uint32_t retired, uint32_t reason) {
+        x.storeContextImm(offsetof(Context, exitPc), exitPc);
+        x.storeContextImm(offsetof(Context, retired), retired);
+        x.storeContextImm(offsetof(Context, exitReason), reason);
+        x.byte(0xC3);  // ret
+    };
+
+    // Computes the effective address into eax/rcx and exits to the
+    // interpreter if the access falls outside guest memory
+    auto emitAddress = [&](uint32_t rs1, int32_t imm, uint32_t size, uint32_t insnPc, uint32_t index) {
+        x.loadGuest(E::EAX, rs1);
+        if (imm != 0) {
+            x.aluEaxImm(0x05, static_cast<uint32_t>(imm));            // add eax, imm
+        }
+        x.bytes({0x89, 0xC1});                                         // mov ecx, eax
+        x.bytes({0x48, 0x8D, 0x51, static_cast<uint8_t>(size)});       // lea rdx, [rcx + size]
+        x.bytes({0x4C, 0x39, 0xCA});                                   // cmp rdx, r9
+        exits.push_back({x.jcc(CC_A), insnPc, index, EXIT_FAULT, 0});
+    };
+
+    // Prologue: mov r8, [rsi+memory]; mov r9, [rsi+memorySize]; mov r10, [rsi+codePages]
+    x.bytes({0x4C, 0x8B, 0x86}); x.dword(offsetof(Context, memory));
+    x.bytes({0x4C, 0x8B, 0x8E}); x.dword(offsetof(Context, memorySize));
+    x.bytes({0x4C, 0x8B, 0x96}); x.dword(offsetof(Context, codePages));
+
+    bool terminated = false;
+    for (uint32_t k = 0; k < count && !terminated; ++k) {
+        const uint32_t insn = InstructionBus::load<uint32_t>(code + 4 * k);
+        const uint32_t insnPc = pc + 4 * k;
+        const uint32_t rd = (insn >> 7) & 0x1F;
+        const uint32_t rs1 = (insn >> 15) & 0x1F;
+        const uint32_t rs2 = (insn >> 20) & 0x1F;
+        const uint32_t funct3 = (insn >> 12) & 0x7;
+        const uint32_t funct7 = insn >> 25;
+        const int32_t immI = static_cast<int32_t>(insn) >> 20;
+
+        switch (insn & 0x7F) {
+            case 0x37:  // LUI
+                if (rd) x.storeGuestImm(rd, insn & 0xFFFFF000);
+                break;
+            case 0x17:  // AUIPC
+                if (rd) x.storeGuestImm(rd, insnPc + (insn & 0xFFFFF000));
+                break;
+            case 0x6F: {  // JAL
+                const int32_t imm = signExtend(((insn >> 31) << 20) | (((insn >> 12) & 0xFF) << 12) |
+                                               (((insn >> 20) & 0x1) << 11) | (((insn >> 21) & 0x3FF) << 1), 21);
+                const uint32_t target = insnPc + static_cast<uint32_t>(imm);
+                if (target & 0x3) return false;
+                if (rd) x.storeGuestImm(rd, insnPc + 4);
+                emitExit(target, k + 1, EXIT_NORMAL);
+                terminated = true;
+                break;
+            }
+            case 0x67:  // JALR
+                if (funct3 != 0) return false;
+                x.loadGuest(E::EAX, rs1);
+                if (immI != 0) x.aluEaxImm(0x05, static_cast<uint32_t>(immI));
+                x.bytes({0x83, 0xE0, 0xFE});                               // and eax, ~1
+                x.bytes({0xA8, 0x03});                                     // test al, 3
+                exits.push_back({x.jcc(CC_NE), insnPc, k, EXIT_FAULT, 0});
+                if (rd) x.storeGuestImm(rd, insnPc + 4);
+                x.storeContextEax(offsetof(Context, exitPc));
+                x.storeContextImm(offsetof(Context, retired), k + 1);
+                x.storeContextImm(offsetof(Context, exitReason), EXIT_NORMAL);
+                x.byte(0xC3);
+                terminated = true;
+                break;
+            case 0x63: {  // BRANCH
+                static const int8_t conds[8] = {CC_E, CC_NE, -1, -1, CC_L, CC_GE, CC_B, CC_AE};
+                if (conds[funct3] < 0) return false;
+                const int32_t imm = signExtend(((insn >> 31) << 12) | (((insn >> 7) & 0x1) << 11) |
+                                               (((insn >> 25) & 0x3F) << 5) | (((insn >> 8) & 0xF) << 1), 13);
+                const uint32_t target = insnPc + static_cast<uint32_t>(imm);
+                if (target & 0x3) return false;
+                x.loadGuest(E::EAX, rs1);
+                x.loadGuest(E::ECX, rs2);
+                x.bytes({0x39, 0xC8});                                     // cmp eax, ecx
+                exits.push_back({x.jcc(static_cast<uint8_t>(conds[funct3])), target, k + 1, EXIT_NORMAL, 0});
+                emitExit(insnPc + 4, k + 1, EXIT_NORMAL);
+                terminated = true;
+                break;
+            }
+            case 0x03: {  // LOAD
+                static const uint8_t sizes[8] = {1, 2, 4, 0, 1, 2, 0, 0};
+                if (!sizes[funct3]) return false;
+                emitAddress(rs1, immI, sizes[funct3], insnPc, k);
+                switch (funct3) {
+                    case 0: x.bytes({0x41, 0x0F, 0xBE, 0x04, 0x08}); break;  // movsx eax, byte [r8+rcx]
+                    case 1: x.bytes({0x41, 0x0F, 0xBF, 0x04, 0x08}); break;  // movsx eax, word [r8+rcx]
+                    case 2: x.bytes({0x41, 0x8B, 0x04, 0x08}); break;        // mov eax, [r8+rcx]
+                    case 4: x.bytes({0x41, 0x0F, 0xB6, 0x04, 0x08}); break;  // movzx eax, byte [r8+rcx]
+                    case 5: x.bytes({0x41, 0x0F, 0xB7, 0x04, 0x08}); break;  // movzx eax, word [r8+rcx]
+                }
+                if (rd) x.storeGuest(rd, E::EAX);
+                break;
+            }
+            case 0x23: {  // STORE
+                static const uint8_t sizes[8] = {1, 2, 4, 0, 0, 0, 0, 0};
+                const uint32_t size = sizes[funct3];
+                if (!size) return false;
+                const int32_t imm = signExtend(((insn >> 25) << 5) | ((insn >> 7) & 0x1F), 12);
+                emitAddress(rs1, imm, size, insnPc, k);
+                x.loadGuest(E::EDX, rs2);
+                switch (size) {
+                    case 1: x.bytes({0x41, 0x88, 0x14, 0x08}); break;        // mov [r8+rcx], dl
+                    case 2: x.bytes({0x66, 0x41, 0x89, 0x14, 0x08}); break;  // mov [r8+rcx], dx
+                    case 4: x.bytes({0x41, 0x89, 0x14, 0x08}); break;        // mov [r8+rcx], edx
+                }
+                // Leave native code if the store touched a translated or decoded page
+                x.bytes({0xC1, 0xE9, 0x0C});                                // shr ecx, 12
+                x.bytes({0x41, 0x80, 0x3C, 0x0A, 0x00});                    // cmp byte [r10+rcx], 0
+                exits.push_back({x.jcc(CC_NE), insnPc + 4, k + 1, EXIT_CODE_WRITE, size});
+                x.bytes({0x8D, 0x48, static_cast<uint8_t>(size - 1)});      // lea ecx, [rax + size - 1]
+                x.bytes({0xC1, 0xE9, 0x0C});
+                x.bytes({0x41, 0x80, 0x3C, 0x0A, 0x00});
+                exits.push_back({x.jcc(CC_NE), insnPc + 4, k + 1, EXIT_CODE_WRITE, size});
+                break;
+            }
+            case 0x13: {  // OP-IMM
+                if (!rd) break;
+                x.loadGuest(E::EAX, rs1);
+                const uint32_t imm = static_cast<uint32_t>(immI);
+                switch (funct3) {
+                    case 0: x.aluEaxImm(0x05, imm); break;                         // add
+                    case 2: x.aluEaxImm(0x3D, imm); x.setEax(CC_L); break;         // slti
+                    case 3: x.aluEaxImm(0x3D, imm); x.setEax(CC_B); break;         // sltiu
+                    case 4: x.aluEaxImm(0x35, imm); break;                         // xor
+                    case 6: x.aluEaxImm(0x0D, imm); break;                         // or
+                    case 7: x.aluEaxImm(0x25, imm); break;                         // and
+                    case 1:
+                        if (funct7 != 0x00) return false;
+                        x.bytes({0xC1, 0xE0, static_cast<uint8_t>(rs2)});          // shl eax, imm
+                        break;
+                    case 5:
+                        if (funct7 == 0x00) {
+                            x.bytes({0xC1, 0xE8, static_cast<uint8_t>(rs2)});      // shr eax, imm
+                        } else if (funct7 == 0x20) {
+                            x.bytes({0xC1, 0xF8, static_cast<uint8_t>(rs2)});      // sar eax, imm
+                        } else {
+                            return false;
+                        }
+                        break;
+                }
+                x.storeGuest(rd, E::EAX);
+                break;
+            }
+            case 0x33: {  // OP
+                if (funct7 != 0x00 && !(funct7 == 0x20 && (funct3 == 0 || funct3 == 5))) return false;
+                if (!rd) break;
+                x.loadGuest(E::EAX, rs1);
+                x.loadGuest(E::ECX, rs2);
+                switch (funct3) {
+                    case 0: x.bytes({static_cast<uint8_t>(funct7 ? 0x29 : 0x01), 0xC8}); break;  // sub/add
+                    case 1: x.bytes({0xD3, 0xE0}); break;                               // shl eax, cl
+                    case 2: x.bytes({0x39, 0xC8}); x.setEax(CC_L); break;               // slt
+                    case 3: x.bytes({0x39, 0xC8}); x.setEax(CC_B); break;               // sltu
+                    case 4: x.bytes({0x31, 0xC8}); break;                               // xor
+                    case 5: x.bytes({0xD3, static_cast<uint8_t>(funct7 ? 0xF8 : 0xE8)}); break;  // sar/shr
+                    case 6: x.bytes({0x09, 0xC8}); break;                               // or
+                    case 7: x.bytes({0x21, 0xC8}); break;                               // and
+                }
+                x.storeGuest(rd, E::EAX);
+                break;
+            }
+            case 0x0F:  // FENCE needs no host ordering on a single hart
+                emitExit(insnPc + 4, k + 1, EXIT_NORMAL);
+                terminated = true;
+                break;
+            default:
+                // ECALL, EBREAK and illegal encodings stay with the interpreter
+                return false;
+        }
+    }
+    if (!terminated) {
+        emitExit(pc + 4 * static_cast<uint32_t>(count), static_cast<uint32_t>(count), EXIT_NORMAL);
+    }
+
+    // Out-of-line exit stubs for conditional exits
+    for (const auto& exit : exits) {
+        x.patch(exit.patchAt, x.size());
+        if (exit.reason == EXIT_CODE_WRITE) {
+            x.storeContextEax(offsetof(Context, storeAddress));
+            x.storeContextImm(offsetof(Context, storeSize), exit.storeSize);
+        }
+        emitExit(exit.pc, exit.retired, exit.reason);
+    }
+    return true;
+}
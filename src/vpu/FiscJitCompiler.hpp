@@ -0,0 +1,67 @@
+#ifndef FISC_JIT_COMPILER_HPP
+#define FISC_JIT_COMPILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(_WIN32)
+#define FISC_JIT_AVAILABLE 1
+#else
+#define FISC_JIT_AVAILABLE 0
+#endif
+
+// Translates hot RV32I basic blocks into x86-64 host code. Guest registers
+// stay memory resident; generated code addresses them through the register
+// file pointer and reaches guest RAM through the Context below.
+class FiscJitCompiler {
+public:
+    // Memory-resident state shared with generated code
+    struct Context {
+        uint8_t* memory;
+        uint64_t memorySize;
+        const uint8_t* codePages;  // Non-zero for pages holding translated blocks
+        uint32_t exitPc;
+        uint32_t retired;          // Instructions completed before the exit
+        uint32_t exitReason;
+        uint32_t storeAddress;     // Valid for EXIT_CODE_WRITE
+        uint32_t storeSize;
+    };
+
+    enum ExitReason : uint32_t {
+        EXIT_NORMAL = 0,      // Block completed, exitPc is the successor
+        EXIT_FAULT = 1,       // Instruction at exitPc must be re-run by the interpreter
+        EXIT_CODE_WRITE = 2   // Store hit a code page, exitPc is the next instruction
+    };
+
+    using BlockFunction = void (*)(uint32_t* registers, Context* context);
+
+    FiscJitCompiler();
+    ~FiscJitCompiler();
+    FiscJitCompiler(const FiscJitCompiler&) = delete;
+    FiscJitCompiler& operator=(const FiscJitCompiler&) = delete;
+
+    // Maps the executable code cache; false if the host cannot run the JIT
+    bool initialize(size_t cacheSize);
+
+    // Returns null if the block holds instructions the translator does not
+    // handle. A full cache is flushed first, which advances the epoch.
+    BlockFunction compile(uint32_t pc, const uint8_t* code, size_t count);
+
+    // Code translated in an earlier epoch has been evicted
+    uint64_t epoch() const { return cacheEpoch; }
+    uint64_t flushCount() const { return cacheEpoch - 1; }
+    size_t bytesUsed() const { return cacheUsed; }
+
+    static constexpr size_t DEFAULT_CACHE_SIZE = 16 * 1024 * 1024;
+
+private:
+    uint8_t* cache;
+    size_t cacheSize;
+    size_t cacheUsed;
+    uint64_t cacheEpoch;
+
+    bool translate(uint32_t pc, const uint8_t* code, size_t count, std::vector<uint8_t>& out);
+};
+
+#endif // FISC_JIT_COMPILER_HPP
@@ -1,42 +1,318 @@
 #include "FiscVpu.hpp"
+#include "FiscBlockEngine.hpp"
+#include "ProgramLoader.hpp"
+#include "CacheModel.hpp"
+#include "InstructionTrace.hpp"
+#include "OutputChannel.hpp"
+#include "Mmu.hpp"
+#include "CpuCore.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
 
-FiscVpu::FiscVpu(const FiscConfigParser& config)
-    : config(config), running(false), pc(0) {
-    std::fill(registers, registers + 32, 0);
+namespace {
+
+// Values of numeric ENUM parameters by ordinal
+const uint32_t ADDRESS_BUS_BITS[] = {4, 8, 16, 20, 24, 32, 64, 128};
+const uint32_t DATA_BUS_BITS[] = {4, 8, 16, 32, 64, 128};
+const uint32_t CACHE_WAYS[] = {1, 2, 4, 8, 16, 0};  // 0 is fully associative
+
+} // namespace
+
+FiscVpu::FiscVpu(std::shared_ptr<const ResolvedConfig> config)
+    : config(config), liveConfig(config), publishedConfig(std::move(config)), configGeneration(0),
+      appliedGeneration(0), debugLevel(DebugLevel::Normal), running(false), pc(0),
+      addressMask(~uint64_t(0)), throttled(true), targetIps(1000000),
+      quantumSize(10000), retiredInstructions(0), runNanoseconds(0), sliceQuantum(10000),
+      paceExecuted(0), paceBaseNanoseconds(0),
+      blockInterrupted(false), perfSequence(0), fetchAddress(0), traceStarted(false),
+      state(RunState::Stopped), parked(true), stepRemaining(0), stepUntil(false), stepTarget(0),
+      guestExit(GuestExit::None), exitStatus(0), decoder(nullptr) {
+    std::fill(registers64, registers64 + 33, 0);
+    resetPerfCounters();
+}
+
+FiscVpu::~FiscVpu() {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        running = false;
+        state = RunState::Stopped;
+    }
+    controlCv.notify_all();
+    if (outputChannel) {
+        outputChannel->wake();
+    }
+    if (runner.joinable()) {
+        runner.join();
+    }
+    closeTrace();
 }
 
 bool FiscVpu::initialize() {
+    // Reap the thread of a guest that halted itself before replacing its state
+    if (state != RunState::Stopped) {
+        return false;
+    }
+    if (runner.joinable()) {
+        runner.join();
+    }
+    
     try {
+        // Adopt everything set since the last run
+        appliedGeneration = configGeneration.load(std::memory_order_acquire);
+        config = std::atomic_load(&publishedConfig);
+        liveConfig = config;
+        debugLevel = config->choice<DebugLevel>(ConfigParam::DEBUG_LEVEL);
+        
         // Get memory size from config
-        auto memSize = std::stoul(config.getParameter("MEMORY_SIZE"));
-        memory.resize(memSize);
+        auto memSize = config->integer(ConfigParam::MEMORY_SIZE);
+        if (!memory.allocate(memSize, config->flag(ConfigParam::HUGE_PAGES))) {
+            throw std::runtime_error("cannot reserve " + std::to_string(memSize) + " bytes of guest memory");
+        }
+        resetDecodeCache();
         
-        // Initialize other parameters from config
-        pc = std::stoul(config.getParameter("START_ADDRESS"));
+        // The architecture is resolved once; everything below depends on it
+        if (!initializeArchitecture()) {
+            return false;
+        }
         
-        loadMiniBios();
+        // Initialize other parameters from config
+        pc = config->integer(ConfigParam::START_ADDRESS);
+        throttled = config->flag(ConfigParam::CPU_THROTTLE);
+        quantumSize = config->integer(ConfigParam::QUANTUM_SIZE);
+        targetIps = config->integer(ConfigParam::CPU_FREQUENCY) * archState.clockMultiplier;
+        retiredInstructions = 0;
+        runNanoseconds = 0;
+        guestExit = GuestExit::None;
+        exitStatus = 0;
+        resetPerfCounters();
         
-        if (!validateArchitectureConfig()) {
-            if (outputCallback) {
-                outputCallback("Invalid architecture configuration");
-            }
+        traceStarted = false;
+        if (!configureCaches() || !openTrace(config->flag(ConfigParam::TRACE_INSTRUCTIONS))) {
+            return false;
+        }
+        configureMmu();
+        createExecutionEngine();
+        core = createCore();
+        if (!core) {
+            emit("No execution core for " + std::string(archState.model->name));
             return false;
         }
         
-        initializeArchitecture();
+        const std::string& image = config->text(ConfigParam::PROGRAM_IMAGE);
+        if (image.empty()) {
+            loadMiniBios();
+        } else if (!loadProgram(image)) {
+            return false;
+        }
+        core->reset(pc);
         return true;
     } catch (const std::exception& e) {
-        if (outputCallback) {
-            outputCallback("VPU initialization failed: " + std::string(e.what()));
+        emit("VPU initialization failed: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void FiscVpu::createExecutionEngine() {
+    blockEngine.reset();
+    const auto engine = config->choice<ExecutionEngine>(ConfigParam::EXECUTION_ENGINE);
+    if (archState.model->family != CpuFamily::RiscV) {
+        if (engine != ExecutionEngine::Interpreter) {
+            emit("Block and JIT engines are RISC-V only, using interpreter");
+        }
+        return;
+    }
+    if (trace && engine != ExecutionEngine::Interpreter) {
+        emit("Instruction tracing is on, using interpreter");
+        return;
+    }
+    if (mmu && engine != ExecutionEngine::Interpreter) {
+        emit("Paging MMU is on, using interpreter");
+        return;
+    }
+    if (engine != ExecutionEngine::Interpreter) {
+        // Translated code bypasses the cache model and emits RV32 code with
+        // little-endian, unwrapped accesses, so other configurations keep
+        // blocks interpreted
+        const bool jitSupported = archState.model->wordBits == 32 && archState.addressBits == 32 &&
+                                  archState.byteOrder == ByteOrder::Little;
+        bool useJit = engine == ExecutionEngine::Jit && !dataCache && jitSupported;
+        blockEngine = std::make_unique<FiscBlockEngine>(*this, useJit);
+        if (engine == ExecutionEngine::Jit && !blockEngine->hasJit()) {
+            emit(dataCache ? "JIT disabled while cache simulation is on, using block engine"
+                 : !jitSupported ? "JIT needs RV32 with a little-endian 32-bit bus, using block engine"
+                                 : "JIT not available on this host, using block engine");
+        }
+    }
+}
+
+bool FiscVpu::configureCaches() {
+    instructionCache.reset();
+    dataCache.reset();
+    if (!config->flag(ConfigParam::CACHE_SIMULATION)) {
+        return true;
+    }
+    if (archState.model->family != CpuFamily::RiscV) {
+        emit("Cache simulation is only available on RISC-V cores");
+        return true;
+    }
+    
+    const auto lineSize = static_cast<uint32_t>(config->integer(ConfigParam::CACHE_LINE_SIZE));
+    const uint32_t ways = CACHE_WAYS[config->ordinal(ConfigParam::CACHE_ASSOCIATIVITY)];
+    const auto policy = config->choice<CacheWritePolicy>(ConfigParam::CACHE_WRITE_POLICY) == CacheWritePolicy::WriteThrough
+        ? CacheModel::WritePolicy::WriteThrough : CacheModel::WritePolicy::WriteBack;
+    
+    std::string error;
+    auto icache = std::make_unique<CacheModel>();
+    auto dcache = std::make_unique<CacheModel>();
+    if (!icache->configure(config->integer(ConfigParam::ICACHE_SIZE), lineSize, ways, policy, error) ||
+        !dcache->configure(config->integer(ConfigParam::DCACHE_SIZE), lineSize, ways, policy, error)) {
+        emit("Invalid cache configuration: " + error);
+        return false;
+    }
+    instructionCache = std::move(icache);
+    dataCache = std::move(dcache);
+    return true;
+}
+
+void FiscVpu::configureMmu() {
+    mmu.reset();
+    const bool paging = archState.mmuType == MmuType::Paging ||
+                        archState.mmuType == MmuType::PagingAndSegmentation;
+    if (!paging || archState.model->family != CpuFamily::RiscV) {
+        return;
+    }
+    mmu = std::make_unique<Mmu>(memory, archState.model->wordBits == 32 ? Mmu::Format::Sv32 : Mmu::Format::Sv39);
+}
+
+void FiscVpu::closeTrace() {
+    if (trace && !trace->close()) {
+        emit("Instruction trace " + config->text(ConfigParam::TRACE_FILE) + " is incomplete: writing it failed");
+    }
+    trace.reset();
+}
+
+bool FiscVpu::openTrace(bool enabled) {
+    closeTrace();
+    if (!enabled) {
+        return true;
+    }
+    if (archState.model->family != CpuFamily::RiscV || archState.model->wordBits != 32) {
+        emit("Instruction tracing is only available on RV32 cores");
+        return true;
+    }
+    
+    bool compress = config->flag(ConfigParam::TRACE_COMPRESSION);
+    if (compress && !InstructionTrace::compressionAvailable()) {
+        emit("Trace compression not available in this build, writing uncompressed");
+    }
+    
+    std::string error;
+    auto sink = std::make_unique<InstructionTrace>();
+    if (!sink->open(config->text(ConfigParam::TRACE_FILE), compress, traceStarted, error)) {
+        emit("Cannot start instruction trace: " + error);
+        return false;
+    }
+    traceStarted = true;
+    trace = std::move(sink);
+    return true;
+}
+
+bool FiscVpu::getCacheStats(CacheStats& instruction, CacheStats& data) const {
+    if (!instructionCache || !dataCache) {
+        return false;
+    }
+    auto convert = [](const CacheModel::Stats& s) {
+        return CacheStats{s.reads, s.writes, s.hits, s.misses, s.evictions, s.writebacks};
+    };
+    instruction = convert(instructionCache->getStats());
+    data = convert(dataCache->getStats());
+    return true;
+}
+
+std::shared_ptr<const FiscVpu::Snapshot> FiscVpu::takeSnapshot() const {
+    if (running || !memory.data() || !core) {
+        return nullptr;
+    }
+    
+    return std::make_shared<Snapshot>(Snapshot{
+        config, archState, throttled, targetIps, quantumSize, memory.capture(), core->saveState()
+    });
+}
+
+std::unique_ptr<FiscVpu> FiscVpu::fork(const Snapshot& snapshot) {
+    // A traced fork writes TRACE_FILE.fork<n>: opening the parent's trace
+    // would truncate it, and forks would overwrite each other's records
+    auto config = snapshot.config;
+    if (config->flag(ConfigParam::TRACE_INSTRUCTIONS)) {
+        static std::atomic<uint64_t> forks(0);
+        std::string error;
+        config = config->withParameter(ConfigParam::TRACE_FILE, config->text(ConfigParam::TRACE_FILE) +
+                                       ".fork" + std::to_string(++forks), error);
+        if (!config) {
+            return nullptr;
         }
+    }
+    auto vpu = std::make_unique<FiscVpu>(std::move(config));
+    if (!vpu->memory.mapImage(*snapshot.memory)) {
+        return nullptr;
+    }
+    
+    // The same configuration steps initialize() takes, minus loading a program
+    vpu->archState = snapshot.archState;
+    vpu->debugLevel = vpu->config->choice<DebugLevel>(ConfigParam::DEBUG_LEVEL);
+    vpu->throttled = snapshot.throttled;
+    vpu->targetIps = snapshot.targetIps;
+    vpu->quantumSize = snapshot.quantumSize;
+    vpu->resetDecodeCache();
+    if (!vpu->configureCaches() || !vpu->openTrace(vpu->config->flag(ConfigParam::TRACE_INSTRUCTIONS))) {
+        return nullptr;
+    }
+    vpu->configureMmu();
+    vpu->createExecutionEngine();
+    vpu->core = vpu->createCore();
+    if (!vpu->core || !vpu->core->restoreState(snapshot.coreState)) {
+        return nullptr;
+    }
+    return vpu;
+}
+
+bool FiscVpu::loadProgram(const std::string& path) {
+    ProgramLoader::LoadedProgram program;
+    std::string error;
+    uint16_t elfMachine = 0;
+    unsigned elfBits = 32;
+    if (archState.model->family == CpuFamily::RiscV) {
+        elfMachine = ProgramLoader::ELF_MACHINE_RISCV;
+        elfBits = archState.model->wordBits == 32 ? 32 : 64;
+    } else if (archState.model->family == CpuFamily::X86) {
+        elfMachine = ProgramLoader::ELF_MACHINE_386;
+    }
+    if (!ProgramLoader::load(path, memory, pc, elfMachine, elfBits, program, error)) {
+        emit("Program load failed: " + error);
         return false;
     }
+    
+    pc = program.entry;
+    emit("Loaded " + std::string(program.isElf ? "ELF" : "raw") + " image " + path +
+         " (" + std::to_string(program.mappedBytes) + " bytes mapped, " +
+         std::to_string(program.copiedBytes) + " copied)");
+    return true;
 }
 
 void FiscVpu::loadMiniBios() {
+    if (archState.model->family == CpuFamily::X86) {
+        // nop; nop; hlt at the reset address
+        const uint8_t miniBios[] = {0x90, 0x90, 0xf4};
+        if (inMemory(pc, sizeof(miniBios))) {
+            std::copy(miniBios, miniBios + sizeof(miniBios), memory.data() + pc);
+        }
+        return;
+    }
+    
     // Simple mini BIOS implementation
     const uint8_t miniBios[] = {
         // Basic BIOS code - this is a placeholder
@@ -47,133 +323,567 @@ void FiscVpu::loadMiniBios() {
     };
     
     // Copy mini BIOS to beginning of memory
-    std::copy(miniBios, miniBios + sizeof(miniBios), memory.begin());
+    std::copy(miniBios, miniBios + sizeof(miniBios), memory.data());
 }
 
 bool FiscVpu::start() {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    if (state != RunState::Stopped) return false;
+    
+    // A guest that halted itself leaves its finished thread to be reaped here
+    if (runner.joinable()) {
+        lock.unlock();
+        runner.join();
+        lock.lock();
+    }
+    if (!beginScheduledRun()) return false;
+    
+    state = RunState::Running;
+    parked = false;
+    runner = std::thread([this]() {
+        runLoop();
+    });
+    return true;
+}
+
+void FiscVpu::stop() {
+    bool wasRunning;
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        wasRunning = running.exchange(false);
+        state = RunState::Stopped;
+    }
+    controlCv.notify_all();
+    // The runner may be blocked on a full output channel
+    if (outputChannel) {
+        outputChannel->wake();
+    }
+    if (runner.joinable() && runner.get_id() != std::this_thread::get_id()) {
+        runner.join();
+    }
+    if (wasRunning) {
+        emit("VPU stopped");
+    }
+}
+
+bool FiscVpu::pause() {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    if (state != RunState::Running && state != RunState::Stepping) return false;
+    
+    state = RunState::Paused;
+    controlCv.notify_all();
+    // Wait for the VPU thread to finish its quantum and park
+    controlCv.wait(lock, [this]() { return parked || !running; });
+    return true;
+}
+
+bool FiscVpu::resume() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (state != RunState::Paused) return false;
+    
+    resetPacing();
+    state = RunState::Running;
+    controlCv.notify_all();
+    return true;
+}
+
+bool FiscVpu::step(uint64_t count) {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    if (state != RunState::Paused || count == 0) return false;
+    
+    stepRemaining = count;
+    stepUntil = false;
+    state = RunState::Stepping;
+    parked = false;
+    controlCv.notify_all();
+    controlCv.wait(lock, [this]() { return state != RunState::Stepping; });
+    return true;
+}
+
+bool FiscVpu::runUntil(uint64_t address) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (state != RunState::Paused && state != RunState::Running) return false;
+    
+    stepRemaining = UINT64_MAX;
+    stepUntil = true;
+    stepTarget = address;
+    state = RunState::Stepping;
+    parked = false;
+    controlCv.notify_all();
+    return true;
+}
+
+bool FiscVpu::beginScheduledRun() {
     if (running) return false;
     
     running = true;
-    if (outputCallback) {
-        outputCallback("VPU started");
+    emit("VPU started");
+    
+    sizeSlices();
+    resetPacing();
+    return true;
+}
+
+void FiscVpu::sizeSlices() {
+    // Throttled quanta are sized to roughly 1 ms of guest time so pacing
+    // stays smooth at low clock rates
+    sliceQuantum = quantumSize;
+    if (throttled) {
+        sliceQuantum = std::max<uint64_t>(1, std::min<uint64_t>(quantumSize, targetIps / 1000));
+    }
+}
+
+void FiscVpu::resetPacing() {
+    paceStart = Clock::now();
+    paceExecuted = 0;
+    paceBaseNanoseconds = runNanoseconds;
+}
+
+void FiscVpu::runLoop() {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    while (running && state != RunState::Stopped) {
+        if (state == RunState::Paused) {
+            parked = true;
+            controlCv.notify_all();
+            controlCv.wait(lock, [this]() { return state != RunState::Paused || !running; });
+            parked = false;
+            continue;
+        }
+        
+        if (state == RunState::Stepping) {
+            uint64_t chunk = std::min(stepRemaining, sliceQuantum);
+            lock.unlock();
+            uint64_t count = runPrecise(chunk);
+            lock.lock();
+            stepRemaining -= std::min(stepRemaining, count);
+            
+            bool reached = (stepUntil && pc == stepTarget) || (!stepUntil && stepRemaining == 0);
+            if (reached && state == RunState::Stepping && running) {
+                state = RunState::Paused;
+                controlCv.notify_all();
+                char where[19];
+                std::snprintf(where, sizeof(where), "0x%08llx", static_cast<unsigned long long>(pc));
+                // Not under controlMutex: a Block-mode channel may keep
+                // emit() waiting, and stop() must still get through
+                lock.unlock();
+                emit(std::string("Paused at ") + where);
+                lock.lock();
+            }
+            continue;
+        }
+        
+        lock.unlock();
+        auto resumeAt = runSlice();
+        lock.lock();
+        
+        // Throttled VPUs sleep on the condition variable so pause and stop
+        // cut the wait short
+        if (resumeAt > Clock::now()) {
+            controlCv.wait_until(lock, resumeAt, [this]() {
+                return state != RunState::Running || !running;
+            });
+        }
     }
     
-    // Start execution in a separate thread
-    std::thread([this]() {
-        while (running) {
-            executeInstruction();
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Also reached when the guest halted itself (ECALL or a trap)
+    state = RunState::Stopped;
+    parked = true;
+    controlCv.notify_all();
+}
+
+uint64_t FiscVpu::runPrecise(uint64_t maxInstructions) {
+    // One instruction at a time so step counts and stop addresses are exact
+    pollConfig();
+    uint64_t count = 0;
+    while (count < maxInstructions && running) {
+        if (stepUntil && pc == stepTarget) {
+            break;
         }
-    }).detach();
+        core->step();
+        ++count;
+    }
+    accountInstructions(count);
+    return count;
+}
+
+void FiscVpu::accountInstructions(uint64_t count) {
+    retiredInstructions.fetch_add(count, std::memory_order_relaxed);
+    perf.instructions += count;
+    publishPerfCounters();
+}
+
+FiscVpu::Clock::time_point FiscVpu::runSlice(uint64_t maxInstructions) {
+    uint64_t count;
+    if (maxInstructions < sliceQuantum) {
+        // Engines finish whole blocks; a cut-short slice stops exactly
+        count = runPrecise(maxInstructions);
+    } else {
+        pollConfig();
+        count = runQuantum(sliceQuantum);
+        accountInstructions(count);
+    }
+    paceExecuted += count;
     
-    return true;
+    auto resumeAt = Clock::now();
+    if (throttled) {
+        auto due = paceStart + std::chrono::nanoseconds(
+            static_cast<int64_t>(paceExecuted * 1e9 / targetIps));
+        resumeAt = std::max(resumeAt, due);
+    }
+    runNanoseconds.store(paceBaseNanoseconds +
+        std::chrono::duration_cast<std::chrono::nanoseconds>(resumeAt - paceStart).count(),
+        std::memory_order_relaxed);
+    return resumeAt;
 }
 
-void FiscVpu::stop() {
-    running = false;
-    if (outputCallback) {
-        outputCallback("VPU stopped");
+FiscVpu::ExecutionStats FiscVpu::getExecutionStats() const {
+    ExecutionStats stats{};
+    stats.instructions = retiredInstructions.load(std::memory_order_relaxed);
+    stats.hostSeconds = runNanoseconds.load(std::memory_order_relaxed) / 1e9;
+    stats.targetIps = static_cast<double>(targetIps);
+    stats.throttled = throttled;
+    if (stats.hostSeconds > 0) {
+        double ips = stats.instructions / stats.hostSeconds;
+        stats.achievedMips = ips / 1e6;
+        stats.throttleAccuracy = 100.0 * ips / stats.targetIps;
     }
+    return stats;
 }
 
-void FiscVpu::executeInstruction() {
-    // Simple instruction execution simulation
-    if (pc >= memory.size() - 4) {
-        stop();
-        return;
+void FiscVpu::resetPerfCounters() {
+    perf = PerfCounters{};
+    publishPerfCounters();
+}
+
+void FiscVpu::publishPerfCounters() {
+    if (mmu) {
+        perf.itlbMisses = mmu->getStats().fetchMisses;
+        perf.dtlbMisses = mmu->getStats().dataMisses;
     }
+    perf.cycles = perf.instructions +
+        uint64_t(archState.waitStates) * archState.busTransfers * (perf.loads() + perf.stores());
     
-    // Fetch instruction (simplified)
-    uint32_t instruction = 
-        (memory[pc] << 24) |
-        (memory[pc + 1] << 16) |
-        (memory[pc + 2] << 8) |
-        memory[pc + 3];
+    uint64_t words[PERF_WORDS];
+    std::memcpy(words, &perf, sizeof(perf));
+    uint32_t sequence = perfSequence.load(std::memory_order_relaxed);
+    perfSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < PERF_WORDS; ++i) {
+        publishedPerf[i].store(words[i], std::memory_order_relaxed);
+    }
+    perfSequence.store(sequence + 2, std::memory_order_release);
+}
+
+FiscVpu::PerfCounters FiscVpu::getPerfCounters() const {
+    uint64_t words[PERF_WORDS];
+    uint32_t sequence;
+    do {
+        sequence = perfSequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < PERF_WORDS; ++i) {
+            words[i] = publishedPerf[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != perfSequence.load(std::memory_order_relaxed));
     
-    // Execute instruction (simplified)
-    if (instruction == 0x00000013) {  // nop
-        if (outputCallback) {
-            outputCallback("Executing NOP");
+    PerfCounters counters;
+    std::memcpy(&counters, words, sizeof(counters));
+    return counters;
+}
+
+void FiscVpu::emit(std::string_view message) {
+    if (outputChannel) {
+        outputChannel->push(message, &running);
+    } else if (outputCallback) {
+        outputCallback(std::string(message));
+    }
+}
+
+void FiscVpu::emitConsole(std::string_view line) {
+    if (consoleCallback) {
+        consoleCallback(std::string(line));
+    } else {
+        emit(line);
+    }
+}
+
+void FiscVpu::halt() {
+    if (guestExit == GuestExit::None) {
+        guestExit = GuestExit::Halted;
+    }
+    running = false;
+    blockInterrupted = true;
+    emit("VPU stopped");
+}
+
+void FiscVpu::exitGuest(int status) {
+    guestExit = GuestExit::Exited;
+    exitStatus = status;
+    halt();
+}
+
+void FiscVpu::executeInstruction() {
+    uint64_t address = pc & addressMask;
+    if (mmu && !translateFetch(address)) {
+        return;
+    }
+    dispatch(address);
+}
+
+template <bool Paged, bool Simulate>
+uint64_t FiscVpu::interpret(uint64_t maxInstructions) {
+    uint64_t count = 0;
+    while (count < maxInstructions && running) {
+        uint64_t address = pc & addressMask;
+        if (Paged && !translateFetch(address)) {
+            ++count;
+            continue;
         }
-    } else if ((instruction & 0x7F) == 0x73) {  // ecall
-        if (outputCallback) {
-            outputCallback("System call executed");
+        if (Simulate && inMemory(address, 4)) {
+            instructionCache->access(address, 4, false);
         }
-        stop();
+        dispatch(address);
+        ++count;
+    }
+    return count;
+}
+
+uint64_t FiscVpu::interpretQuantum(uint64_t maxInstructions) {
+    if (mmu) {
+        return instructionCache ? interpret<true, true>(maxInstructions)
+                                : interpret<true, false>(maxInstructions);
+    }
+    return instructionCache ? interpret<false, true>(maxInstructions)
+                            : interpret<false, false>(maxInstructions);
+}
+
+uint64_t FiscVpu::runQuantum(uint64_t maxInstructions) {
+    return core->run(maxInstructions);
+}
+
+std::unique_ptr<CpuCore> FiscVpu::createCore() {
+    switch (archState.model->family) {
+        case CpuFamily::RiscV:
+            return createRiscVCore();
+        case CpuFamily::X86:
+            return createX86Core();
+        default:
+            return nullptr;
+    }
+}
+
+const FiscVpu::ArchitectureModel* FiscVpu::findArchitecture(uint32_t ordinal) {
+    static const ArchitectureModel models[] = {
+        {"RISC-V-32", CpuFamily::RiscV, 32, Endianness::Bi, FpuType::None, false, false},
+        {"RISC-V-64", CpuFamily::RiscV, 64, Endianness::Bi, FpuType::None, false, false},
+        {"RISC-V-128", CpuFamily::RiscV, 128, Endianness::Bi, FpuType::None, false, false},
+        {"8086", CpuFamily::X86, 16, Endianness::Little, FpuType::I8087, false, false},
+        {"80186", CpuFamily::X86, 16, Endianness::Little, FpuType::None, false, false},
+        {"80286", CpuFamily::X86, 16, Endianness::Little, FpuType::I80287, true, false},
+        {"80386", CpuFamily::X86, 32, Endianness::Little, FpuType::I80387, true, false},
+        {"80486", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"Pentium", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, true},
+        {"80386SX", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"80386DX", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"80486SX", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"80486DX", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"80486DX2", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"80486DX4", CpuFamily::X86, 32, Endianness::Little, FpuType::None, true, false},
+        {"8080", CpuFamily::Z80, 8, Endianness::Little, FpuType::None, false, false},
+        {"Z80", CpuFamily::Z80, 8, Endianness::Little, FpuType::None, false, false},
+        {"6502", CpuFamily::Mos6502, 8, Endianness::Little, FpuType::None, false, false},
+        {"6800", CpuFamily::M6800, 8, Endianness::Big, FpuType::None, false, false},
+        {"65816", CpuFamily::Mos6502, 16, Endianness::Little, FpuType::None, false, false},
+        {"68000", CpuFamily::M68000, 16, Endianness::Big, FpuType::None, false, false},
+        {"Intel-4004", CpuFamily::Mcs4, 4, Endianness::Little, FpuType::None, false, false},
+        {"Intel-4040", CpuFamily::Mcs4, 4, Endianness::Little, FpuType::None, false, false},
+    };
+    if (ordinal >= sizeof(models) / sizeof(models[0])) {
+        return nullptr;
+    }
+    return &models[ordinal];
+}
+
+bool FiscVpu::checkConfig(const ResolvedConfig& config, ConfigParam& param, std::string& reason) {
+    ArchitectureState state;
+    if (!resolveArchitecture(config, state, param, reason) || !validateArchitectureConfig(state, param, reason)) {
+        return false;
     }
     
-    pc += 4;
+    // Cache geometry is only used, and so only checked, where it is simulated
+    if (config.flag(ConfigParam::CACHE_SIMULATION) && state.model->family == CpuFamily::RiscV) {
+        const auto lineSize = static_cast<uint32_t>(config.integer(ConfigParam::CACHE_LINE_SIZE));
+        const uint32_t ways = CACHE_WAYS[config.ordinal(ConfigParam::CACHE_ASSOCIATIVITY)];
+        for (ConfigParam size : {ConfigParam::ICACHE_SIZE, ConfigParam::DCACHE_SIZE}) {
+            if (!CacheModel::checkGeometry(static_cast<uint32_t>(config.integer(size)), lineSize, ways, reason)) {
+                param = size;
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-void FiscVpu::initializeArchitecture() {
-    std::string arch = config.getParameter("ARCHITECTURE");
+bool FiscVpu::initializeArchitecture() {
+    ConfigParam param;
+    std::string reason;
+    if (!resolveArchitecture(*config, archState, param, reason) ||
+        !validateArchitectureConfig(archState, param, reason)) {
+        emit("Invalid architecture configuration: " + reason);
+        return false;
+    }
     
-    // Initialize architecture-specific state
-    archState.realMode = config.getParameter("X86_REAL_MODE") == "true";
-    archState.protectedMode = config.getParameter("X86_PROTECTED_MODE") == "true";
-    archState.segmentation = config.getParameter("SEGMENT_REGISTERS") == "true";
-    archState.fpuType = config.getParameter("FPU_TYPE");
-    archState.mmuType = config.getParameter("MMU_TYPE");
-    archState.simdSupport = config.getParameter("SIMD_SUPPORT");
-    archState.virtualizationEnabled = config.getParameter("VIRTUALIZATION_SUPPORT") == "true";
-    archState.clockMultiplier = std::stoul(config.getParameter("CLOCK_MULTIPLIER"));
-    archState.waitStates = std::stoul(config.getParameter("WAIT_STATES"));
-    
-    // Initialize segment registers for x86 architectures
-    if (arch.find("80") == 0 || arch == "Pentium") {
-        archState.cs = archState.ds = archState.es = 
-        archState.fs = archState.gs = archState.ss = 0;
-    }
-    
-    if (outputCallback) {
-        outputCallback("Initialized " + arch + " architecture");
+    emit("Initialized " + std::string(archState.model->name) + " architecture");
+    if (archState.model->family == CpuFamily::X86) {
         if (archState.realMode) {
-            outputCallback("Running in real mode");
+            emit("Running in real mode");
         }
         if (archState.protectedMode) {
-            outputCallback("Protected mode enabled");
+            emit("Protected mode enabled");
         }
     }
+    return true;
 }
 
-bool FiscVpu::validateArchitectureConfig() {
-    std::string arch = config.getParameter("ARCHITECTURE");
+bool FiscVpu::resolveArchitecture(const ResolvedConfig& config, ArchitectureState& state,
+                                  ConfigParam& param, std::string& reason) {
+    param = ConfigParam::ARCHITECTURE;
+    const std::string& arch = config.text(ConfigParam::ARCHITECTURE);
+    state.model = findArchitecture(config.ordinal(ConfigParam::ARCHITECTURE));
+    if (!state.model || arch != state.model->name) {
+        reason = "no model for " + arch;
+        return false;
+    }
+    
+    // Initialize architecture-specific state
+    state.realMode = config.flag(ConfigParam::X86_REAL_MODE);
+    state.protectedMode = config.flag(ConfigParam::X86_PROTECTED_MODE);
+    state.segmentation = config.flag(ConfigParam::SEGMENT_REGISTERS);
+    state.virtualizationEnabled = config.flag(ConfigParam::VIRTUALIZATION_SUPPORT);
+    state.clockMultiplier = static_cast<uint32_t>(config.integer(ConfigParam::CLOCK_MULTIPLIER));
+    state.waitStates = static_cast<uint32_t>(config.integer(ConfigParam::WAIT_STATES));
+    state.fpuType = config.choice<FpuType>(ConfigParam::FPU_TYPE);
+    state.mmuType = config.choice<MmuType>(ConfigParam::MMU_TYPE);
+    state.simdSupport = config.choice<SimdSupport>(ConfigParam::SIMD_SUPPORT);
+    const auto endianness = config.choice<Endianness>(ConfigParam::ENDIANNESS);
+    // Fixed-order CPUs accept only their own ENDIANNESS
+    if (endianness != state.model->endianness && state.model->endianness != Endianness::Bi) {
+        param = ConfigParam::ENDIANNESS;
+        reason = arch + " is " + (state.model->endianness == Endianness::Big ? "big" : "little") + "-endian";
+        return false;
+    }
+    state.byteOrder = endianness == Endianness::Big ? ByteOrder::Big : ByteOrder::Little;
+    
+    // Buses at least as wide as the word need no wrapping or splitting
+    const uint32_t wordBits = state.model->wordBits;
+    const uint32_t addressBits = ADDRESS_BUS_BITS[config.ordinal(ConfigParam::ADDRESS_BUS_WIDTH)];
+    const uint32_t dataBits = DATA_BUS_BITS[config.ordinal(ConfigParam::DATA_BUS_WIDTH)];
+    state.addressBits = static_cast<uint8_t>(std::min(addressBits, wordBits));
+    state.busTransfers = dataBits < wordBits ? (wordBits + dataBits - 1) / dataBits : 1;
+    return true;
+}
+
+bool FiscVpu::validateArchitectureConfig(const ArchitectureState& state, ConfigParam& param, std::string& reason) {
+    const ArchitectureModel& model = *state.model;
     
     // Validate architecture-specific configurations
-    if (arch.find("80") == 0 || arch == "Pentium") {
-        // x86 family validation
-        if (arch == "8086" || arch == "80186") {
-            if (config.getParameter("X86_PROTECTED_MODE") == "true") {
-                return false; // These CPUs don't support protected mode
-            }
+    if (model.family == CpuFamily::X86) {
+        if (state.protectedMode && !model.protectedMode) {
+            param = ConfigParam::X86_PROTECTED_MODE;
+            reason = std::string(model.name) + " has no protected mode";
+            return false;
         }
-        
-        if (archState.realMode && archState.protectedMode) {
-            return false; // Can't be in both modes simultaneously
+        if (state.realMode && state.protectedMode) {
+            param = ConfigParam::X86_REAL_MODE;
+            reason = "X86_REAL_MODE and X86_PROTECTED_MODE are exclusive";
+            return false;
         }
     }
     
     // Validate FPU configuration
-    if (archState.fpuType != "none") {
-        if (arch == "8086" && archState.fpuType != "8087") return false;
-        if (arch == "80286" && archState.fpuType != "80287") return false;
-        if (arch == "80386" && archState.fpuType != "80387") return false;
+    if (state.fpuType != FpuType::None && model.coprocessor != FpuType::None &&
+        state.fpuType != model.coprocessor) {
+        param = ConfigParam::FPU_TYPE;
+        reason = std::string(model.name) + " only pairs with its own coprocessor";
+        return false;
     }
     
     // Validate SIMD support
-    if (archState.simdSupport != "none") {
-        if (arch != "Pentium") return false; // Only Pentium and later support SIMD
+    if (state.simdSupport != SimdSupport::None && !model.simd) {
+        param = ConfigParam::SIMD_SUPPORT;
+        reason = std::string(model.name) + " has no SIMD extensions";  // Only Pentium and later support SIMD
+        return false;
+    }
+    
+    // RISC-V load/store paths exist for 16-bit and wider address buses,
+    // and for 32-bit and wider ones on RV64
+    const uint32_t minimumAddressBits = model.wordBits == 32 ? 16 : 32;
+    if (model.family == CpuFamily::RiscV && state.addressBits < minimumAddressBits) {
+        param = ConfigParam::ADDRESS_BUS_WIDTH;
+        reason = std::string(model.name) + " needs an address bus of at least " +
+                 std::to_string(minimumAddressBits) + " bits";
+        return false;
     }
     
     return true;
 }
 
 bool FiscVpu::setConfigParameter(const std::string& param, const std::string& value) {
-    if (!running) {
-        return config.setParameter(param, value);
+    ConfigParam key;
+    if (!ResolvedConfig::lookup(param, key)) {
+        return false;
+    }
+    if (running && !FiscConfigSchema::get(key).hotReload) {
+        emit(param + " can only be changed while the VPU is stopped");
+        return false;
     }
-    if (outputCallback) {
-        outputCallback("Cannot modify configuration while VPU is running");
+    
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::string error;
+    auto updated = std::atomic_load(&publishedConfig)->withParameter(key, value, error);
+    if (!updated) {
+        return false;
+    }
+    std::atomic_store(&publishedConfig, std::move(updated));
+    configGeneration.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void FiscVpu::applyConfigUpdates() {
+    // Runs on the VPU thread between quanta. Only hot parameters are taken
+    // from the new snapshot; the rest wait for the next initialize().
+    appliedGeneration = configGeneration.load(std::memory_order_acquire);
+    auto next = std::atomic_load(&publishedConfig);
+    const ResolvedConfig& previous = *liveConfig;
+    
+    debugLevel = next->choice<DebugLevel>(ConfigParam::DEBUG_LEVEL);
+    if (next->integer(ConfigParam::CPU_FREQUENCY) != previous.integer(ConfigParam::CPU_FREQUENCY) ||
+        next->flag(ConfigParam::CPU_THROTTLE) != previous.flag(ConfigParam::CPU_THROTTLE)) {
+        throttled = next->flag(ConfigParam::CPU_THROTTLE);
+        targetIps = next->integer(ConfigParam::CPU_FREQUENCY) * archState.clockMultiplier;
+        sizeSlices();
+        resetPacing();
+    }
+    if (next->flag(ConfigParam::TRACE_INSTRUCTIONS) != previous.flag(ConfigParam::TRACE_INSTRUCTIONS)) {
+        // Tracing runs on the interpreter, so the engine follows the trace
+        if (openTrace(next->flag(ConfigParam::TRACE_INSTRUCTIONS))) {
+            createExecutionEngine();
+        } else {
+            // openTrace() reported why; the VPU keeps running untraced on
+            // its current engine, and setting the flag again retries
+            std::string error;
+            if (auto untraced = next->withParameter(ConfigParam::TRACE_INSTRUCTIONS, "false", error)) {
+                next = std::move(untraced);
+            }
+        }
+    }
+    
+    if (debugLevel >= DebugLevel::Verbose) {
+        for (size_t i = 0; i < CONFIG_PARAM_COUNT; ++i) {
+            const auto param = static_cast<ConfigParam>(i);
+            if (FiscConfigSchema::get(param).hotReload && next->text(param) != previous.text(param)) {
+                emit(std::string("Applied ") + ResolvedConfig::name(param) + " = " + next->text(param));
+            }
+        }
     }
-    return false;
+    liveConfig = std::move(next);
 } 
\ No newline at end of file
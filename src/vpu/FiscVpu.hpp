@@ -2,59 +2,394 @@
 #define FISC_VPU_HPP
 
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <functional>
-#include "../config/FiscConfigParser.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "../config/ResolvedConfig.hpp"
+#include "GuestMemory.hpp"
+#include "GuestBus.hpp"
+
+class FiscBlockEngine;
+class CacheModel;
+class InstructionTrace;
+class OutputChannel;
+class Mmu;
+class CpuCore;
 
 class FiscVpu {
 public:
-    FiscVpu(const FiscConfigParser& config);
+    explicit FiscVpu(std::shared_ptr<const ResolvedConfig> config);
+    ~FiscVpu();
     
     bool initialize();
+    
+    // Execution control. start() runs the VPU on a thread it owns; the
+    // other calls take effect at the next quantum boundary and stop()
+    // joins the thread. step() runs exactly n instructions from a paused
+    // VPU and returns once it has paused again; runUntil() runs until pc
+    // reaches an address and pauses there asynchronously.
+    enum class RunState : uint8_t {
+        Stopped,
+        Running,
+        Paused,
+        Stepping
+    };
     bool start();
     void stop();
+    bool pause();
+    bool resume();
+    bool step(uint64_t count);
+    bool runUntil(uint64_t address);
+    RunState getState() const { return state; }
     bool isRunning() const { return running; }
+    uint64_t getProgramCounter() const { return pc; }  // Meaningful while paused or stopped
+    
+    // How the guest's last run ended; meaningful once it has stopped.
+    // Exited carries the status the guest passed (RISC-V ECALL a0, DOS
+    // INT 21h AH=4Ch AL).
+    enum class GuestExit : uint8_t {
+        None,     // Not ended by the guest: still running, or stop()
+        Exited,
+        Halted,   // x86 HLT, or execution left guest memory
+        Trapped   // Illegal instruction, breakpoint or fault
+    };
+    GuestExit getGuestExit() const { return guestExit; }
+    int getExitStatus() const { return exitStatus; }
+    
+    // Externally scheduled execution, used by VpuPool in place of start().
+    // runSlice() executes one paced quantum, or exactly maxInstructions if
+    // that is fewer, and returns the earliest time the next one may begin.
+    using Clock = std::chrono::steady_clock;
+    bool beginScheduledRun();
+    Clock::time_point runSlice(uint64_t maxInstructions = UINT64_MAX);
     
-    // Register a callback for BIOS output
+    // Register a callback for BIOS output; runs synchronously on the VPU thread
     void setOutputCallback(std::function<void(const std::string&)> callback) {
         outputCallback = callback;
     }
     
-    // Configuration methods
-    const FiscConfigParser& getConfig() const { return config; }
+    // Lines the guest prints on its console (x86 INT 10h/21h). Without a
+    // console callback they are emitted with the VPU's own messages.
+    void setConsoleCallback(std::function<void(const std::string&)> callback) {
+        consoleCallback = callback;
+    }
+    
+    // Queue BIOS output for a front end to drain instead; takes precedence
+    // over the callback
+    void setOutputChannel(std::shared_ptr<OutputChannel> channel) {
+        outputChannel = std::move(channel);
+    }
+    
+    // Copy-on-write snapshots. A snapshot captures registers, pc,
+    // architecture state and guest RAM of a stopped VPU; fork() builds a
+    // ready-to-start VPU from it without going through initialize(). A
+    // traced fork writes its own TRACE_FILE.fork<n>, n counting forks made
+    // by this process.
+    struct Snapshot;
+    std::shared_ptr<const Snapshot> takeSnapshot() const;
+    static std::unique_ptr<FiscVpu> fork(const Snapshot& snapshot);
+    
+    // Configuration methods. Changes made while stopped apply at the next
+    // initialize(). While the VPU runs only hot-reloadable parameters may
+    // change: each change publishes a new immutable configuration, which
+    // the VPU thread adopts at its next quantum boundary. getConfig()
+    // returns the latest published configuration.
+    std::shared_ptr<const ResolvedConfig> getConfig() const { return std::atomic_load(&publishedConfig); }
     bool setConfigParameter(const std::string& param, const std::string& value);
+    
+    // Rules spanning several parameters, which the schema checks one value
+    // at a time cannot see. initialize() applies the same rules; on failure
+    // param is the setting at fault.
+    static bool checkConfig(const ResolvedConfig& config, ConfigParam& param, std::string& reason);
+
+    // Execution statistics, safe to read while the VPU runs
+    struct ExecutionStats {
+        uint64_t instructions;
+        double hostSeconds;
+        double targetIps;       // CPU_FREQUENCY * CLOCK_MULTIPLIER
+        bool throttled;
+        double achievedMips;
+        double throttleAccuracy;  // Achieved / target rate in percent (throttled runs)
+    };
+    ExecutionStats getExecutionStats() const;
+    
+    // L1 cache model counters; false when CACHE_SIMULATION is off
+    struct CacheStats {
+        uint64_t reads;
+        uint64_t writes;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t writebacks;
+    };
+    bool getCacheStats(CacheStats& instruction, CacheStats& data) const;
+    
+    // True when MMU_TYPE selects a paging MMU
+    bool hasPagingMmu() const { return mmu != nullptr; }
+    
+    // Guest RAM size and the part of it currently backed by host memory
+    size_t getMemorySize() const { return memory.size(); }
+    size_t getResidentMemory() const { return memory.residentBytes(); }
+
+    // Predecoded RV32I/RV64I instruction: handler plus pre-extracted operands
+    enum class OpClass : uint8_t {
+        Alu,
+        Load,
+        Store,
+        Branch,
+        Jump,
+        System
+    };
+    struct DecodedInstruction;
+    using InstructionHandler = void (*)(FiscVpu& vpu, const DecodedInstruction& insn);
+    struct DecodedInstruction {
+        InstructionHandler handler;
+        uint8_t rd;
+        uint8_t rs1;
+        uint8_t rs2;
+        OpClass opClass;
+        int32_t imm;  // Sign-extended immediate (raw encoding for illegal instructions)
+    };
+    using Decoder = DecodedInstruction (*)(uint32_t instruction);
+    
+    // Guest performance counters. Cycles follow a simple in-order model:
+    // one per instruction plus WAIT_STATES per load or store.
+    static constexpr size_t OP_CLASS_COUNT = 6;
+    struct alignas(64) PerfCounters {
+        uint64_t instructions;
+        uint64_t cycles;
+        uint64_t opClasses[OP_CLASS_COUNT];  // Retired instructions per OpClass
+        uint64_t takenBranches;
+        uint64_t traps;
+        uint64_t itlbMisses;  // TLB hits are the fetches/accesses that did not miss
+        uint64_t dtlbMisses;
+        
+        uint64_t loads() const { return opClasses[static_cast<size_t>(OpClass::Load)]; }
+        uint64_t stores() const { return opClasses[static_cast<size_t>(OpClass::Store)]; }
+    };
+    // Consistent snapshot as of the last completed quantum; safe from any thread
+    PerfCounters getPerfCounters() const;
 
 private:
-    FiscConfigParser config;  // Now owned by VPU, not a reference
-    bool running;
+    template <typename Reg> friend struct RiscVOps;
+    friend struct X86Ops;
+    template <typename Reg> friend class RiscVCore;
+    friend class X86Core;
+    friend class FiscBlockEngine;
+
+    // config is what initialize() built the VPU from; liveConfig the
+    // snapshot whose hot parameters the VPU thread last applied. Writers
+    // swap publishedConfig (std::atomic_load/atomic_store only) and bump
+    // configGeneration, so a quantum boundary costs one integer load.
+    std::shared_ptr<const ResolvedConfig> config;
+    std::shared_ptr<const ResolvedConfig> liveConfig;
+    std::shared_ptr<const ResolvedConfig> publishedConfig;
+    std::atomic<uint64_t> configGeneration;
+    uint64_t appliedGeneration;
+    std::mutex publishMutex;  // Orders writers; the VPU thread never takes it
+    DebugLevel debugLevel;
+    void pollConfig() {
+        if (configGeneration.load(std::memory_order_acquire) != appliedGeneration) {
+            applyConfigUpdates();
+        }
+    }
+    void applyConfigUpdates();
+    std::atomic<bool> running;  // Guest is live; cleared by halt() or stop()
     std::function<void(const std::string&)> outputCallback;
+    std::shared_ptr<OutputChannel> outputChannel;
+    std::function<void(const std::string&)> consoleCallback;
+    void emit(std::string_view message);
+    void emitConsole(std::string_view line);
+    
+    // VPU state; writes to x0 are redirected to REGISTER_SINK at decode time.
+    // RV32 cores use registers, RV64 cores registers64.
+    static constexpr uint8_t REGISTER_SINK = 32;
+    union {
+        uint32_t registers[33];
+        uint64_t registers64[33];
+    };
+    uint64_t pc;
+    GuestMemory memory;
+    uint64_t addressMask;  // ADDRESS_BUS_WIDTH, applied to instruction fetches
+    
+    // Decode cache, one lazily allocated page of entries per 4 KiB of guest memory
+    static constexpr uint32_t DECODE_PAGE_SHIFT = 12;
+    static constexpr uint32_t DECODE_PAGE_SIZE = 1u << DECODE_PAGE_SHIFT;
+    struct DecodedPage {
+        DecodedInstruction insns[DECODE_PAGE_SIZE / 4];
+    };
+    std::vector<std::unique_ptr<DecodedPage>> decodeCache;
+    
+    // Quantum scheduling; pacing changes live, so stats read it atomically
+    std::atomic<bool> throttled;
+    std::atomic<uint64_t> targetIps;
+    uint64_t quantumSize;
+    std::atomic<uint64_t> retiredInstructions;
+    std::atomic<int64_t> runNanoseconds;
+    uint64_t sliceQuantum;
+    Clock::time_point paceStart;
+    uint64_t paceExecuted;
+    int64_t paceBaseNanoseconds;
+    
+    // Basic-block engine (EXECUTION_ENGINE=block or jit); null when interpreting
+    std::unique_ptr<FiscBlockEngine> blockEngine;
+    bool blockInterrupted;  // Set by traps, halt() and code invalidation
+    
+    // Live counters belong to the executing thread and are plain increments;
+    // publishPerfCounters() copies them out under a sequence lock per quantum
+    PerfCounters perf;
+    static constexpr size_t PERF_WORDS = sizeof(PerfCounters) / sizeof(uint64_t);
+    std::atomic<uint32_t> perfSequence;
+    std::atomic<uint64_t> publishedPerf[PERF_WORDS];
+    void countOpClass(OpClass opClass) { ++perf.opClasses[static_cast<size_t>(opClass)]; }
+    void resetPerfCounters();
+    void publishPerfCounters();
+    
+    // L1 cache models (CACHE_SIMULATION=true); null when simulation is off
+    std::unique_ptr<CacheModel> instructionCache;
+    std::unique_ptr<CacheModel> dataCache;
+    bool configureCaches();
+    
+    // Paging MMU (MMU_TYPE=paging); null otherwise. Paging runs on the
+    // interpreter, and the decode cache is indexed by physical address.
+    std::unique_ptr<Mmu> mmu;
+    uint64_t fetchAddress;  // Physical address of the instruction being executed
+    void configureMmu();
+    bool translateFetch(uint64_t& address);
+    
+    // Binary trace sink (TRACE_INSTRUCTIONS=true); tracing runs on the interpreter
+    std::unique_ptr<InstructionTrace> trace;
+    bool traceStarted;  // TRACE_FILE was created this run; reopening appends to it
+    bool openTrace(bool enabled);
+    void closeTrace();  // Reports a trace that could not be written in full
+    uint64_t runTracedQuantum(uint64_t maxInstructions);
     
-    // VPU state
-    uint32_t registers[32];
-    uint32_t pc;
-    std::vector<uint8_t> memory;
+    // Execution core for ARCHITECTURE, chosen once by initialize()
+    std::unique_ptr<CpuCore> core;
+    std::unique_ptr<CpuCore> createCore();
+    std::unique_ptr<CpuCore> createRiscVCore();  // FiscVpuRiscV.cpp
+    std::unique_ptr<CpuCore> createX86Core();    // FiscVpuX86.cpp
+    
+    // Execution controller; state changes are made under controlMutex
+    std::atomic<RunState> state;
+    std::thread runner;
+    std::mutex controlMutex;
+    std::condition_variable controlCv;
+    bool parked;  // VPU thread is idle and not touching guest state
+    uint64_t stepRemaining;
+    bool stepUntil;
+    uint64_t stepTarget;
     
     void executeInstruction();
+    // Overflow-safe bounds check for 64-bit guest addresses
+    bool inMemory(uint64_t address, uint64_t size) const {
+        return address <= memory.size() && size <= memory.size() - address;
+    }
+    void dispatch(uint64_t address) {
+        if (!inMemory(address, 4)) {
+            halt();
+            return;
+        }
+        // Dispatch through the decode cache; undecoded entries decode themselves
+        const DecodedInstruction& insn =
+            decodedPage(address).insns[(address & (DECODE_PAGE_SIZE - 1)) >> 2];
+        countOpClass(insn.opClass);
+        insn.handler(*this, insn);
+    }
+    template <bool Paged, bool Simulate>
+    uint64_t interpret(uint64_t maxInstructions);
+    uint64_t interpretQuantum(uint64_t maxInstructions);
+    uint64_t runQuantum(uint64_t maxInstructions);
+    uint64_t runPrecise(uint64_t maxInstructions);
+    void accountInstructions(uint64_t count);
+    void resetPacing();
+    void sizeSlices();
+    void runLoop();
+    void halt();  // Ends execution from the VPU thread (ECALL, traps)
+    void exitGuest(int status);
+    GuestExit guestExit;
+    int exitStatus;
     void loadMiniBios();
+    bool loadProgram(const std::string& path);
+    
+    // RISC-V decoder and helpers (FiscVpuRiscV.cpp). The decoder is chosen
+    // once per configuration so handlers come specialised for XLEN, the
+    // data byte order, address bus, cache model and MMU.
+    Decoder decoder;
+    void selectDecoder();
+    DecodedInstruction decode(uint32_t instruction) const;
+    DecodedPage& decodedPage(uint64_t addr);
+    void invalidateDecoded(uint64_t addr, uint32_t size);
+    void resetDecodeCache();
+    void trap(const std::string& reason);
+    
+    enum class CpuFamily : uint8_t {
+        RiscV,
+        X86,
+        Z80,      // Also the 8080
+        Mos6502,  // Also the 65816
+        M6800,
+        M68000,
+        Mcs4      // Intel 4004/4040
+    };
+    // FPU_TYPE, MMU_TYPE, SIMD_SUPPORT and ENDIANNESS ordinals
+    enum class FpuType : uint8_t { None, I8087, I80287, I80387, I80487, Internal };
+    enum class MmuType : uint8_t { None, Basic, Paging, Segmentation, PagingAndSegmentation };
+    enum class SimdSupport : uint8_t { None, Mmx, Sse, Sse2, Sse3, Ssse3, Sse4, Avx };
+    enum class Endianness : uint8_t { Little, Big, Bi };
     
+    // One entry per ARCHITECTURE value, in schema order (FiscVpu.cpp)
+    struct ArchitectureModel {
+        const char* name;
+        CpuFamily family;
+        uint8_t wordBits;
+        Endianness endianness;  // Bi: data byte order is selectable
+        FpuType coprocessor;   // The only FPU it accepts; None if unrestricted
+        bool protectedMode;    // X86_PROTECTED_MODE is allowed
+        bool simd;
+    };
+    
+    // Configuration resolved from strings once per initialize()
     struct ArchitectureState {
+        const ArchitectureModel* model;
         bool realMode;
         bool protectedMode;
         bool segmentation;
-        std::string fpuType;
-        std::string mmuType;
-        std::string simdSupport;
+        FpuType fpuType;
+        MmuType mmuType;
+        SimdSupport simdSupport;
         bool virtualizationEnabled;
         uint32_t clockMultiplier;
         uint32_t waitStates;
-        
-        // Segment registers (for x86)
-        uint16_t cs, ds, es, fs, gs, ss;
+        ByteOrder byteOrder;      // Data byte order; bi-endian cores start little
+        uint8_t addressBits;      // Narrower than wordBits wraps guest addresses
+        uint32_t busTransfers;    // Data bus transfers per word-sized access
     };
     
     ArchitectureState archState;
-    void initializeArchitecture();
-    bool validateArchitectureConfig();
+    static const ArchitectureModel* findArchitecture(uint32_t ordinal);
+    bool initializeArchitecture();
+    static bool resolveArchitecture(const ResolvedConfig& config, ArchitectureState& state,
+                                    ConfigParam& param, std::string& reason);
+    static bool validateArchitectureConfig(const ArchitectureState& state, ConfigParam& param, std::string& reason);
+    void createExecutionEngine();
+};
+
+struct FiscVpu::Snapshot {
+    std::shared_ptr<const ResolvedConfig> config;
+    ArchitectureState archState;
+    bool throttled;
+    uint64_t targetIps;
+    uint64_t quantumSize;
+    std::shared_ptr<const GuestMemoryImage> memory;
+    std::vector<uint8_t> coreState;  // CpuCore::saveState()
 };
 
-#endif // FISC_VPU_HPP 
\ No newline at end of file
+#endif // FISC_VPU_HPP
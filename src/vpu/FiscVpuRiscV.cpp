@@ -0,0 +1,893 @@
+#include "FiscVpu.hpp"
+#include "CpuCore.hpp"
+#include "FiscBlockEngine.hpp"
+#include "CacheModel.hpp"
+#include "InstructionTrace.hpp"
+#include "Mmu.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+std::string hex32(uint32_t value) {
+    char buf[11];
+    std::snprintf(buf, sizeof(buf), "0x%08x", value);
+    return buf;
+}
+
+// Addresses above 4 GiB only occur on RV64 and print at full width
+std::string hexAddress(uint64_t value) {
+    char buf[19];
+    std::snprintf(buf, sizeof(buf), value >> 32 ? "0x%016llx" : "0x%08llx",
+                  static_cast<unsigned long long>(value));
+    return buf;
+}
+
+int32_t signExtend(uint32_t value, int bits) {
+    const uint32_t mask = 1u << (bits - 1);
+    return static_cast<int32_t>((value ^ mask) - mask);
+}
+
+} // namespace
+
+// RISC-V instruction handlers for one XLEN: Reg is uint32_t for RV32I and
+// uint64_t for RV64I. Each handler executes one predecoded instruction and
+// advances pc; traps leave pc on the faulting instruction.
+template <typename Reg>
+struct RiscVOps {
+    using Insn = FiscVpu::DecodedInstruction;
+    using SReg = typename std::make_signed<Reg>::type;
+    static constexpr uint32_t XLEN = 8 * sizeof(Reg);
+
+    static Reg* regs(FiscVpu& vpu) {
+        if constexpr (XLEN == 32) {
+            return vpu.registers;
+        } else {
+            return vpu.registers64;
+        }
+    }
+    static Reg pc(const FiscVpu& vpu) { return static_cast<Reg>(vpu.pc); }
+    static Reg imm(const Insn& i) { return static_cast<Reg>(static_cast<SReg>(i.imm)); }
+    static void next(FiscVpu& vpu) { vpu.pc = static_cast<Reg>(vpu.pc + 4); }
+
+    // RV64 word operations compute in 32 bits and sign-extend the result
+    static Reg signExtendWord(uint32_t value) {
+        return static_cast<Reg>(static_cast<SReg>(static_cast<int32_t>(value)));
+    }
+
+    // The fault path stays out of line so the check inlines into handlers
+    static bool checkAccess(FiscVpu& vpu, uint64_t addr, uint32_t size, const char* kind) {
+        if (vpu.inMemory(addr, size)) {
+            return true;
+        }
+        accessFault(vpu, addr, kind);
+        return false;
+    }
+    static void accessFault(FiscVpu& vpu, uint64_t addr, const char* kind) {
+        vpu.trap(std::string(kind) + " access fault at " + hexAddress(addr) +
+                 " (pc " + hexAddress(vpu.pc) + ")");
+    }
+
+    static void jumpTo(FiscVpu& vpu, Reg target) {
+        if (target & 0x3) {
+            vpu.trap("Instruction address misaligned: " + hexAddress(target) +
+                     " (pc " + hexAddress(vpu.pc) + ")");
+            return;
+        }
+        vpu.pc = target;
+    }
+
+    // Fills in a cache entry on first execution, then runs it
+    static void opDecode(FiscVpu& vpu, const Insn&) {
+        // The decode cache is indexed by physical address
+        const uint64_t address = vpu.mmu ? vpu.fetchAddress : vpu.pc & vpu.addressMask;
+        const uint32_t raw = InstructionBus::load<uint32_t>(&vpu.memory[address]);
+        Insn& entry = vpu.decodedPage(address).insns[(address & (FiscVpu::DECODE_PAGE_SIZE - 1)) >> 2];
+
+        // The dispatch was counted under the stale class; move it to the real one
+        --vpu.perf.opClasses[static_cast<size_t>(entry.opClass)];
+        entry = vpu.decode(raw);
+        vpu.countOpClass(entry.opClass);
+        entry.handler(vpu, entry);
+    }
+
+    static void opIllegal(FiscVpu& vpu, const Insn& i) {
+        vpu.trap("Illegal instruction " + hex32(static_cast<uint32_t>(i.imm)) +
+                 " at " + hexAddress(vpu.pc));
+    }
+
+    // Upper immediates and jumps
+    static void opLui(FiscVpu& vpu, const Insn& i) {
+        regs(vpu)[i.rd] = imm(i);
+        next(vpu);
+    }
+
+    static void opAuipc(FiscVpu& vpu, const Insn& i) {
+        regs(vpu)[i.rd] = pc(vpu) + imm(i);
+        next(vpu);
+    }
+
+    static void opJal(FiscVpu& vpu, const Insn& i) {
+        Reg link = pc(vpu) + 4;
+        Reg target = pc(vpu) + imm(i);
+        if (target & 0x3) {
+            jumpTo(vpu, target);
+            return;
+        }
+        regs(vpu)[i.rd] = link;
+        vpu.pc = target;
+    }
+
+    static void opJalr(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        Reg link = pc(vpu) + 4;
+        Reg target = (x[i.rs1] + imm(i)) & ~Reg(1);
+        if (target & 0x3) {
+            jumpTo(vpu, target);
+            return;
+        }
+        x[i.rd] = link;
+        vpu.pc = target;
+    }
+
+    // Conditional branches
+    static void branch(FiscVpu& vpu, const Insn& i, bool taken) {
+        if (taken) {
+            ++vpu.perf.takenBranches;
+            jumpTo(vpu, pc(vpu) + imm(i));
+        } else {
+            next(vpu);
+        }
+    }
+
+    static void opBeq(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, x[i.rs1] == x[i.rs2]);
+    }
+    static void opBne(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, x[i.rs1] != x[i.rs2]);
+    }
+    static void opBlt(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, static_cast<SReg>(x[i.rs1]) < static_cast<SReg>(x[i.rs2]));
+    }
+    static void opBge(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, static_cast<SReg>(x[i.rs1]) >= static_cast<SReg>(x[i.rs2]));
+    }
+    static void opBltu(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, x[i.rs1] < x[i.rs2]);
+    }
+    static void opBgeu(FiscVpu& vpu, const Insn& i) {
+        const Reg* x = regs(vpu);
+        branch(vpu, i, x[i.rs1] >= x[i.rs2]);
+    }
+
+    // Translates a data address through the MMU onto the address bus.
+    // Accesses that straddle a page are rejected as misaligned, which the
+    // spec permits.
+    template <typename Bus>
+    static bool translateData(FiscVpu& vpu, uint64_t vaddr, uint32_t size, bool store, uint64_t& addr) {
+        const char* kind = store ? "Store" : "Load";
+        if ((vaddr & Mmu::PAGE_MASK) + size > Mmu::PAGE_SIZE) {
+            vpu.trap(std::string(kind) + " address misaligned across pages: " + hexAddress(vaddr) +
+                     " (pc " + hexAddress(vpu.pc) + ")");
+            return false;
+        }
+        uint64_t paddr;
+        if (!(store ? vpu.mmu->translateStore(vaddr, paddr) : vpu.mmu->translateLoad(vaddr, paddr))) {
+            vpu.trap(std::string(kind) + " page fault at " + hexAddress(vaddr) + " (pc " + hexAddress(vpu.pc) + ")");
+            return false;
+        }
+        paddr = Bus::wrap(paddr);
+        if (!vpu.inMemory(paddr, size)) {
+            vpu.trap(std::string(kind) + " access fault at physical " + hexAddress(paddr) +
+                     " (pc " + hexAddress(vpu.pc) + ")");
+            return false;
+        }
+        addr = paddr;
+        return true;
+    }
+
+    // Loads and stores. Bus fixes the data byte order and address width,
+    // Simulate selects the variant that also drives the data cache model,
+    // Paged the one that translates through the MMU. Signed T sign-extends.
+    template <typename T, typename Bus, bool Simulate, bool Paged>
+    static void opLoad(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        uint64_t addr = static_cast<Reg>(x[i.rs1] + imm(i));
+        if (Paged) {
+            if (!translateData<Bus>(vpu, addr, sizeof(T), false, addr)) {
+                return;
+            }
+        } else {
+            addr = Bus::wrap(addr);
+            if (!checkAccess(vpu, addr, sizeof(T), "Load")) {
+                return;
+            }
+        }
+        if (Simulate) {
+            vpu.dataCache->access(addr, sizeof(T), false);
+        }
+        const T value = Bus::template load<T>(&vpu.memory[addr]);
+        x[i.rd] = static_cast<Reg>(static_cast<SReg>(value));
+        next(vpu);
+    }
+
+    template <typename T, typename Bus, bool Simulate, bool Paged>
+    static void opStore(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        uint64_t addr = static_cast<Reg>(x[i.rs1] + imm(i));
+        if (Paged) {
+            if (!translateData<Bus>(vpu, addr, sizeof(T), true, addr)) {
+                return;
+            }
+        } else {
+            addr = Bus::wrap(addr);
+            if (!checkAccess(vpu, addr, sizeof(T), "Store")) {
+                return;
+            }
+        }
+        if (Simulate) {
+            vpu.dataCache->access(addr, sizeof(T), true);
+        }
+        Bus::template store<T>(&vpu.memory[addr], static_cast<T>(x[i.rs2]));
+        vpu.invalidateDecoded(addr, sizeof(T));
+        next(vpu);
+    }
+
+    // Register-immediate ALU; shift amounts are predecoded into imm
+    static void opAddi(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] + imm(i);
+        next(vpu);
+    }
+    static void opSlti(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = static_cast<SReg>(x[i.rs1]) < i.imm;
+        next(vpu);
+    }
+    static void opSltiu(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] < imm(i);
+        next(vpu);
+    }
+    static void opXori(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] ^ imm(i);
+        next(vpu);
+    }
+    static void opOri(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] | imm(i);
+        next(vpu);
+    }
+    static void opAndi(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] & imm(i);
+        next(vpu);
+    }
+    static void opSlli(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] << i.imm;
+        next(vpu);
+    }
+    static void opSrli(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] >> i.imm;
+        next(vpu);
+    }
+    static void opSrai(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = static_cast<Reg>(static_cast<SReg>(x[i.rs1]) >> i.imm);
+        next(vpu);
+    }
+
+    // Register-register ALU
+    static void opAdd(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] + x[i.rs2];
+        next(vpu);
+    }
+    static void opSub(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] - x[i.rs2];
+        next(vpu);
+    }
+    static void opSll(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] << (x[i.rs2] & (XLEN - 1));
+        next(vpu);
+    }
+    static void opSlt(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = static_cast<SReg>(x[i.rs1]) < static_cast<SReg>(x[i.rs2]);
+        next(vpu);
+    }
+    static void opSltu(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] < x[i.rs2];
+        next(vpu);
+    }
+    static void opXor(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] ^ x[i.rs2];
+        next(vpu);
+    }
+    static void opSrl(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] >> (x[i.rs2] & (XLEN - 1));
+        next(vpu);
+    }
+    static void opSra(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = static_cast<Reg>(static_cast<SReg>(x[i.rs1]) >> (x[i.rs2] & (XLEN - 1)));
+        next(vpu);
+    }
+    static void opOr(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] | x[i.rs2];
+        next(vpu);
+    }
+    static void opAnd(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = x[i.rs1] & x[i.rs2];
+        next(vpu);
+    }
+
+    // RV64I word operations (OP-IMM-32 and OP-32)
+    static void opAddiw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) + static_cast<uint32_t>(i.imm));
+        next(vpu);
+    }
+    static void opSlliw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) << i.imm);
+        next(vpu);
+    }
+    static void opSrliw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) >> i.imm);
+        next(vpu);
+    }
+    static void opSraiw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(static_cast<int32_t>(x[i.rs1]) >> i.imm));
+        next(vpu);
+    }
+    static void opAddw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) + static_cast<uint32_t>(x[i.rs2]));
+        next(vpu);
+    }
+    static void opSubw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) - static_cast<uint32_t>(x[i.rs2]));
+        next(vpu);
+    }
+    static void opSllw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) << (x[i.rs2] & 0x1F));
+        next(vpu);
+    }
+    static void opSrlw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(x[i.rs1]) >> (x[i.rs2] & 0x1F));
+        next(vpu);
+    }
+    static void opSraw(FiscVpu& vpu, const Insn& i) {
+        Reg* x = regs(vpu);
+        x[i.rd] = signExtendWord(static_cast<uint32_t>(static_cast<int32_t>(x[i.rs1]) >> (x[i.rs2] & 0x1F)));
+        next(vpu);
+    }
+
+    // System
+    static void opFence(FiscVpu& vpu, const Insn&) {
+        next(vpu);
+    }
+
+    static void opEcall(FiscVpu& vpu, const Insn&) {
+        vpu.emit("System call executed");
+        next(vpu);
+        vpu.exitGuest(static_cast<int32_t>(regs(vpu)[10]));
+    }
+
+    static void opEbreak(FiscVpu& vpu, const Insn&) {
+        vpu.trap("Breakpoint at " + hexAddress(vpu.pc));
+    }
+
+    // Only satp is implemented, and only when a paging MMU is configured
+    static constexpr int32_t CSR_SATP = 0x180;
+
+    static void opCsr(FiscVpu& vpu, const Insn& i) {
+        if (i.imm != CSR_SATP || !vpu.mmu) {
+            vpu.trap("Unsupported CSR " + hex32(static_cast<uint32_t>(i.imm)) + " at " + hexAddress(vpu.pc));
+            return;
+        }
+        Reg* x = regs(vpu);
+        const Reg old = static_cast<Reg>(vpu.mmu->getSatp());
+        const Reg operand = (i.rs2 & 0x4) ? i.rs1 : x[i.rs1];
+        switch (i.rs2 & 0x3) {
+            case 1:
+                vpu.mmu->setSatp(operand);
+                break;
+            case 2:
+                if (i.rs1 != 0) {
+                    vpu.mmu->setSatp(old | operand);
+                }
+                break;
+            case 3:
+                if (i.rs1 != 0) {
+                    vpu.mmu->setSatp(old & ~operand);
+                }
+                break;
+        }
+        x[i.rd] = old;
+        next(vpu);
+    }
+
+    static void opSfenceVma(FiscVpu& vpu, const Insn& i) {
+        if (vpu.mmu) {
+            if (i.rs1 == 0) {
+                vpu.mmu->flush();
+            } else {
+                vpu.mmu->flushPage(regs(vpu)[i.rs1]);
+            }
+        }
+        next(vpu);
+    }
+};
+
+namespace {
+
+template <typename Reg, typename Bus, bool Simulate, bool Paged>
+FiscVpu::InstructionHandler loadHandler(uint32_t funct3) {
+    using Ops = RiscVOps<Reg>;
+    switch (funct3) {
+        case 0: return &Ops::template opLoad<int8_t, Bus, Simulate, Paged>;
+        case 1: return &Ops::template opLoad<int16_t, Bus, Simulate, Paged>;
+        case 2: return &Ops::template opLoad<int32_t, Bus, Simulate, Paged>;
+        case 4: return &Ops::template opLoad<uint8_t, Bus, Simulate, Paged>;
+        case 5: return &Ops::template opLoad<uint16_t, Bus, Simulate, Paged>;
+    }
+    if constexpr (sizeof(Reg) == 8) {
+        if (funct3 == 3) return &Ops::template opLoad<uint64_t, Bus, Simulate, Paged>;  // LD
+        if (funct3 == 6) return &Ops::template opLoad<uint32_t, Bus, Simulate, Paged>;  // LWU
+    }
+    return nullptr;
+}
+
+template <typename Reg, typename Bus, bool Simulate, bool Paged>
+FiscVpu::InstructionHandler storeHandler(uint32_t funct3) {
+    using Ops = RiscVOps<Reg>;
+    switch (funct3) {
+        case 0: return &Ops::template opStore<uint8_t, Bus, Simulate, Paged>;
+        case 1: return &Ops::template opStore<uint16_t, Bus, Simulate, Paged>;
+        case 2: return &Ops::template opStore<uint32_t, Bus, Simulate, Paged>;
+    }
+    if constexpr (sizeof(Reg) == 8) {
+        if (funct3 == 3) return &Ops::template opStore<uint64_t, Bus, Simulate, Paged>;  // SD
+    }
+    return nullptr;
+}
+
+template <typename Reg, typename Bus, bool Simulate, bool Paged>
+FiscVpu::DecodedInstruction decodeRiscV(uint32_t instruction) {
+    using Ops = RiscVOps<Reg>;
+    using InstructionHandler = FiscVpu::InstructionHandler;
+    using OpClass = FiscVpu::OpClass;
+    constexpr bool RV64 = sizeof(Reg) == 8;
+    FiscVpu::DecodedInstruction insn{};
+    insn.rd = (instruction >> 7) & 0x1F;
+    insn.rs1 = (instruction >> 15) & 0x1F;
+    insn.rs2 = (instruction >> 20) & 0x1F;
+    const uint32_t funct3 = (instruction >> 12) & 0x7;
+    const uint32_t funct7 = instruction >> 25;
+
+    const int32_t immI = static_cast<int32_t>(instruction) >> 20;
+    const int32_t immS = signExtend(((instruction >> 25) << 5) | ((instruction >> 7) & 0x1F), 12);
+    const int32_t immB = signExtend(((instruction >> 31) << 12) | (((instruction >> 7) & 0x1) << 11) |
+                                    (((instruction >> 25) & 0x3F) << 5) | (((instruction >> 8) & 0xF) << 1), 13);
+    const int32_t immU = static_cast<int32_t>(instruction & 0xFFFFF000);
+    const int32_t immJ = signExtend(((instruction >> 31) << 20) | (((instruction >> 12) & 0xFF) << 12) |
+                                    (((instruction >> 20) & 0x1) << 11) | (((instruction >> 21) & 0x3FF) << 1), 21);
+
+    // RV64 shift immediates take a sixth bit from funct7
+    const uint32_t shamt = (instruction >> 20) & (Ops::XLEN - 1);
+    const uint32_t shiftKind = RV64 ? instruction >> 26 : funct7;
+    const uint32_t arithmeticShift = RV64 ? 0x10 : 0x20;
+
+    insn.handler = &Ops::opIllegal;
+    switch (instruction & 0x7F) {
+        case 0x37:  // LUI
+            insn.handler = &Ops::opLui;
+            insn.imm = immU;
+            return insn;
+        case 0x17:  // AUIPC
+            insn.handler = &Ops::opAuipc;
+            insn.imm = immU;
+            return insn;
+        case 0x6F:  // JAL
+            insn.opClass = OpClass::Jump;
+            insn.handler = &Ops::opJal;
+            insn.imm = immJ;
+            return insn;
+        case 0x67:  // JALR
+            insn.opClass = OpClass::Jump;
+            if (funct3 == 0) {
+                insn.handler = &Ops::opJalr;
+                insn.imm = immI;
+                return insn;
+            }
+            break;
+        case 0x63: {  // BRANCH
+            insn.opClass = OpClass::Branch;
+            static const InstructionHandler branches[8] = {
+                &Ops::opBeq, &Ops::opBne, nullptr, nullptr,
+                &Ops::opBlt, &Ops::opBge, &Ops::opBltu, &Ops::opBgeu
+            };
+            if (branches[funct3]) {
+                insn.handler = branches[funct3];
+                insn.imm = immB;
+                return insn;
+            }
+            break;
+        }
+        case 0x03:  // LOAD
+            insn.opClass = OpClass::Load;
+            if (InstructionHandler handler = loadHandler<Reg, Bus, Simulate, Paged>(funct3)) {
+                insn.handler = handler;
+                insn.imm = immI;
+                return insn;
+            }
+            break;
+        case 0x23:  // STORE
+            insn.opClass = OpClass::Store;
+            if (InstructionHandler handler = storeHandler<Reg, Bus, Simulate, Paged>(funct3)) {
+                insn.handler = handler;
+                insn.imm = immS;
+                return insn;
+            }
+            break;
+        case 0x13:  // OP-IMM
+            insn.imm = immI;
+            switch (funct3) {
+                case 0: insn.handler = &Ops::opAddi; return insn;
+                case 2: insn.handler = &Ops::opSlti; return insn;
+                case 3: insn.handler = &Ops::opSltiu; return insn;
+                case 4: insn.handler = &Ops::opXori; return insn;
+                case 6: insn.handler = &Ops::opOri; return insn;
+                case 7: insn.handler = &Ops::opAndi; return insn;
+                case 1:
+                    if (shiftKind == 0) {
+                        insn.handler = &Ops::opSlli;
+                        insn.imm = static_cast<int32_t>(shamt);
+                        return insn;
+                    }
+                    break;
+                case 5:
+                    if (shiftKind == 0 || shiftKind == arithmeticShift) {
+                        insn.handler = shiftKind ? &Ops::opSrai : &Ops::opSrli;
+                        insn.imm = static_cast<int32_t>(shamt);
+                        return insn;
+                    }
+                    break;
+            }
+            break;
+        case 0x33:  // OP
+            if (funct7 == 0x00) {
+                static const InstructionHandler ops[8] = {
+                    &Ops::opAdd, &Ops::opSll, &Ops::opSlt, &Ops::opSltu,
+                    &Ops::opXor, &Ops::opSrl, &Ops::opOr, &Ops::opAnd
+                };
+                insn.handler = ops[funct3];
+                return insn;
+            }
+            if (funct7 == 0x20 && (funct3 == 0 || funct3 == 5)) {
+                insn.handler = funct3 ? &Ops::opSra : &Ops::opSub;
+                return insn;
+            }
+            break;
+        case 0x1B:  // OP-IMM-32
+            if constexpr (RV64) {
+                if (funct3 == 0) {
+                    insn.handler = &Ops::opAddiw;
+                    insn.imm = immI;
+                    return insn;
+                }
+                if ((funct3 == 1 && funct7 == 0x00) || (funct3 == 5 && (funct7 == 0x00 || funct7 == 0x20))) {
+                    insn.handler = funct3 == 1 ? &Ops::opSlliw : funct7 ? &Ops::opSraiw : &Ops::opSrliw;
+                    insn.imm = insn.rs2;
+                    return insn;
+                }
+            }
+            break;
+        case 0x3B:  // OP-32
+            if constexpr (RV64) {
+                if (funct7 == 0x00 && (funct3 == 0 || funct3 == 1 || funct3 == 5)) {
+                    insn.handler = funct3 == 0 ? &Ops::opAddw : funct3 == 1 ? &Ops::opSllw : &Ops::opSrlw;
+                    return insn;
+                }
+                if (funct7 == 0x20 && (funct3 == 0 || funct3 == 5)) {
+                    insn.handler = funct3 ? &Ops::opSraw : &Ops::opSubw;
+                    return insn;
+                }
+            }
+            break;
+        case 0x0F:  // MISC-MEM (FENCE, FENCE.I)
+            insn.opClass = OpClass::System;
+            insn.handler = &Ops::opFence;
+            return insn;
+        case 0x73:  // SYSTEM
+            insn.opClass = OpClass::System;
+            if (instruction == 0x00000073) {
+                insn.handler = &Ops::opEcall;
+                return insn;
+            }
+            if (instruction == 0x00100073) {
+                insn.handler = &Ops::opEbreak;
+                return insn;
+            }
+            if ((instruction & 0xFE007FFF) == 0x12000073) {
+                insn.handler = &Ops::opSfenceVma;
+                return insn;
+            }
+            if (funct3 != 0 && funct3 != 4) {
+                // Zicsr: the CSR number travels in imm, funct3 in rs2
+                insn.handler = &Ops::opCsr;
+                insn.imm = static_cast<int32_t>(instruction >> 20);
+                insn.rs2 = static_cast<uint8_t>(funct3);
+                return insn;
+            }
+            break;
+    }
+
+    insn.handler = &Ops::opIllegal;
+    insn.opClass = OpClass::System;
+    insn.imm = static_cast<int32_t>(instruction);
+    return insn;
+}
+
+template <typename Reg, typename Bus>
+FiscVpu::Decoder riscVDecoder(bool simulate, bool paged) {
+    if (paged) {
+        return simulate ? &decodeRiscV<Reg, Bus, true, true> : &decodeRiscV<Reg, Bus, false, true>;
+    }
+    return simulate ? &decodeRiscV<Reg, Bus, true, false> : &decodeRiscV<Reg, Bus, false, false>;
+}
+
+// RV32 buses may be 16 to 32 bits wide, RV64 buses 32 or 64
+template <typename Reg, ByteOrder Order>
+FiscVpu::Decoder riscVDecoder(uint32_t addressBits, bool simulate, bool paged) {
+    if constexpr (sizeof(Reg) == 8) {
+        return addressBits >= 64 ? riscVDecoder<Reg, GuestBus<Order, 64>>(simulate, paged)
+                                 : riscVDecoder<Reg, GuestBus<Order, 32>>(simulate, paged);
+    } else {
+        switch (addressBits) {
+            case 16: return riscVDecoder<Reg, GuestBus<Order, 16>>(simulate, paged);
+            case 20: return riscVDecoder<Reg, GuestBus<Order, 20>>(simulate, paged);
+            case 24: return riscVDecoder<Reg, GuestBus<Order, 24>>(simulate, paged);
+            default: return riscVDecoder<Reg, GuestBus<Order, 32>>(simulate, paged);
+        }
+    }
+}
+
+template <typename Reg>
+FiscVpu::Decoder riscVDecoder(ByteOrder order, uint32_t addressBits, bool simulate, bool paged) {
+    return order == ByteOrder::Big ? riscVDecoder<Reg, ByteOrder::Big>(addressBits, simulate, paged)
+                                   : riscVDecoder<Reg, ByteOrder::Little>(addressBits, simulate, paged);
+}
+
+} // namespace
+
+void FiscVpu::selectDecoder() {
+    // Cache-simulating and translating load/store handlers are only chosen
+    // when the cache model or MMU is present
+    const uint32_t addressBits = archState.addressBits;
+    addressMask = addressBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << addressBits) - 1;
+    decoder = archState.model->wordBits == 64
+        ? riscVDecoder<uint64_t>(archState.byteOrder, addressBits, dataCache != nullptr, mmu != nullptr)
+        : riscVDecoder<uint32_t>(archState.byteOrder, addressBits, dataCache != nullptr, mmu != nullptr);
+}
+
+FiscVpu::DecodedInstruction FiscVpu::decode(uint32_t instruction) const {
+    DecodedInstruction insn = decoder(instruction);
+    // Redirect writes to x0 into a sink slot so x0 never needs re-zeroing
+    if (insn.rd == 0) {
+        insn.rd = REGISTER_SINK;
+    }
+    return insn;
+}
+
+// The trace format records 32-bit state, so only RV32 cores trace
+uint64_t FiscVpu::runTracedQuantum(uint64_t maxInstructions) {
+    uint64_t count = 0;
+    while (count < maxInstructions && running) {
+        uint64_t address = pc & addressMask;
+        if (mmu && !translateFetch(address)) {
+            ++count;
+            continue;
+        }
+        if (!inMemory(address, 4)) {
+            executeInstruction();
+            ++count;
+            continue;
+        }
+        
+        // Addresses in the trace are virtual
+        TraceRecord& record = trace->nextRecord();
+        uint32_t raw = InstructionBus::load<uint32_t>(&memory[address]);
+        uint32_t opcode = raw & 0x7f;
+        record.pc = static_cast<uint32_t>(pc);
+        record.instruction = raw;
+        record.memAddress = 0;
+        record.memSize = 0;
+        record.flags = 0;
+        record.reserved = 0;
+        if (opcode == 0x03) {
+            record.memAddress = registers[(raw >> 15) & 0x1f] + static_cast<uint32_t>(signExtend(raw >> 20, 12));
+            record.memSize = 1 << ((raw >> 12) & 0x3);
+        } else if (opcode == 0x23) {
+            uint32_t imm = ((raw >> 25) << 5) | ((raw >> 7) & 0x1f);
+            record.memAddress = registers[(raw >> 15) & 0x1f] + static_cast<uint32_t>(signExtend(imm, 12));
+            record.memSize = 1 << ((raw >> 12) & 0x3);
+            record.flags = TRACE_STORE;
+        }
+        
+        uint64_t traps = perf.traps;
+        executeInstruction();
+        ++count;
+        
+        // Branches, stores, FENCE and SYSTEM carry no destination register
+        bool writesRd = opcode != 0x63 && opcode != 0x23 && opcode != 0x0f && opcode != 0x73;
+        record.rd = writesRd ? (raw >> 7) & 0x1f : 0;
+        record.rdValue = record.rd ? registers[record.rd] : 0;
+        if (perf.traps != traps) {
+            record.flags |= TRACE_TRAP;
+        }
+        trace->commitRecord();
+    }
+    trace->publish();
+    return count;
+}
+
+bool FiscVpu::translateFetch(uint64_t& address) {
+    uint64_t paddr;
+    if (!mmu->translateFetch(pc, paddr)) {
+        trap("Instruction page fault at " + hexAddress(pc));
+        return false;
+    }
+    paddr &= addressMask;
+    if (!inMemory(paddr, 4)) {
+        trap("Instruction access fault at physical " + hexAddress(paddr) +
+             " (pc " + hexAddress(pc) + ")");
+        return false;
+    }
+    address = fetchAddress = paddr;
+    return true;
+}
+
+FiscVpu::DecodedPage& FiscVpu::decodedPage(uint64_t addr) {
+    auto& page = decodeCache[addr >> DECODE_PAGE_SHIFT];
+    if (!page) {
+        // opDecode reads no registers, so one instantiation serves every XLEN
+        page = std::make_unique<DecodedPage>();
+        for (auto& entry : page->insns) {
+            entry = DecodedInstruction{&RiscVOps<uint32_t>::opDecode, 0, 0, 0, OpClass::System, 0};
+        }
+        if (blockEngine) {
+            blockEngine->watchDecodedPage(addr >> DECODE_PAGE_SHIFT);
+        }
+    }
+    return *page;
+}
+
+void FiscVpu::invalidateDecoded(uint64_t addr, uint32_t size) {
+    // Only pages that have been executed from carry decoded entries
+    for (uint64_t word = addr & ~uint64_t(3); word < addr + size; word += 4) {
+        uint64_t pageIndex = word >> DECODE_PAGE_SHIFT;
+        auto& page = decodeCache[pageIndex];
+        if (page) {
+            page->insns[(word & (DECODE_PAGE_SIZE - 1)) >> 2].handler = &RiscVOps<uint32_t>::opDecode;
+        }
+        if (blockEngine && blockEngine->isCodePage(pageIndex)) {
+            blockEngine->invalidatePage(pageIndex);
+        }
+    }
+}
+
+void FiscVpu::resetDecodeCache() {
+    decodeCache.clear();
+    decodeCache.resize((memory.size() + DECODE_PAGE_SIZE - 1) >> DECODE_PAGE_SHIFT);
+}
+
+void FiscVpu::trap(const std::string& reason) {
+    guestExit = GuestExit::Trapped;
+    blockInterrupted = true;
+    ++perf.traps;
+    emit(reason);
+    halt();
+}
+
+// RISC-V core for one XLEN. Its register file, decode cache and execution
+// engines stay in FiscVpu, where the block engine and JIT address them
+// directly.
+template <typename Reg>
+class RiscVCore final : public CpuCore {
+public:
+    explicit RiscVCore(FiscVpu& vpu) : vpu(vpu) {}
+
+    void reset(uint64_t entry) override {
+        std::fill(vpu.registers64, vpu.registers64 + 33, 0);
+        vpu.pc = static_cast<Reg>(entry);
+    }
+
+    uint64_t run(uint64_t maxInstructions) override {
+        if (vpu.trace) {
+            return vpu.runTracedQuantum(maxInstructions);
+        }
+        if (vpu.blockEngine) {
+            return vpu.blockEngine->run(maxInstructions);
+        }
+        return vpu.interpretQuantum(maxInstructions);
+    }
+
+    void step() override {
+        if (vpu.trace) {
+            vpu.runTracedQuantum(1);
+        } else {
+            vpu.interpretQuantum(1);
+        }
+    }
+
+    std::vector<uint8_t> saveState() const override {
+        SavedState saved{};
+        const Reg* x = RiscVOps<Reg>::regs(vpu);
+        std::copy(x, x + 33, saved.registers);
+        saved.pc = vpu.pc;
+        saved.satp = vpu.mmu ? vpu.mmu->getSatp() : 0;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&saved);
+        return std::vector<uint8_t>(bytes, bytes + sizeof(saved));
+    }
+
+    bool restoreState(const std::vector<uint8_t>& bytes) override {
+        if (bytes.size() != sizeof(SavedState)) {
+            return false;
+        }
+        SavedState saved;
+        std::memcpy(&saved, bytes.data(), sizeof(saved));
+        std::copy(saved.registers, saved.registers + 33, RiscVOps<Reg>::regs(vpu));
+        vpu.pc = saved.pc;
+        if (vpu.mmu) {
+            vpu.mmu->setSatp(saved.satp);
+        }
+        return true;
+    }
+
+private:
+    struct SavedState {
+        Reg registers[33];
+        uint64_t pc;
+        uint64_t satp;
+    };
+
+    FiscVpu& vpu;
+};
+
+std::unique_ptr<CpuCore> FiscVpu::createRiscVCore() {
+    switch (archState.model->wordBits) {
+        case 32:
+            selectDecoder();
+            return std::make_unique<RiscVCore<uint32_t>>(*this);
+        case 64:
+            selectDecoder();
+            return std::make_unique<RiscVCore<uint64_t>>(*this);
+        default:
+            return nullptr;  // RV128 has no core
+    }
+}
@@ -0,0 +1,1575 @@
+#include "FiscVpu.hpp"
+#include "CpuCore.hpp"
+#include "X86State.hpp"
+#include "OutputChannel.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint16_t FLAG_CF = 0x0001;
+constexpr uint16_t FLAG_PF = 0x0004;
+constexpr uint16_t FLAG_AF = 0x0010;
+constexpr uint16_t FLAG_ZF = 0x0040;
+constexpr uint16_t FLAG_SF = 0x0080;
+constexpr uint16_t FLAG_TF = 0x0100;
+constexpr uint16_t FLAG_IF = 0x0200;
+constexpr uint16_t FLAG_DF = 0x0400;
+constexpr uint16_t FLAG_OF = 0x0800;
+constexpr uint16_t ARITHMETIC_FLAGS = FLAG_CF | FLAG_PF | FLAG_AF | FLAG_ZF | FLAG_SF | FLAG_OF;
+constexpr uint16_t WRITABLE_FLAGS = ARITHMETIC_FLAGS | FLAG_TF | FLAG_IF | FLAG_DF;
+constexpr uint16_t FIXED_FLAGS = 0xf002;  // Reserved bits read as set on the 8086/80186
+
+// Real-mode addresses wrap at 1 MiB, as on the 8086's 20-bit bus
+using RealModeBus = GuestBus<ByteOrder::Little, 20>;
+constexpr uint32_t REAL_MODE_LIMIT = 1u << RealModeBus::ADDRESS_BITS;
+constexpr int MAX_PREFIXES = 15;
+
+std::string farAddress(uint16_t segment, uint16_t offset) {
+    char buf[10];
+    std::snprintf(buf, sizeof(buf), "%04X:%04X", segment, offset);
+    return buf;
+}
+
+std::string hex8(uint8_t value) {
+    char buf[5];
+    std::snprintf(buf, sizeof(buf), "0x%02x", value);
+    return buf;
+}
+
+bool parityEven(uint32_t value) {
+    value &= 0xff;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return !(value & 1);
+}
+
+} // namespace
+
+// x86 family core: owns the register file and the console line written by
+// the built-in BIOS/DOS services
+class X86Core final : public CpuCore {
+public:
+    X86Core(FiscVpu& vpu, bool has186);
+
+    void reset(uint64_t entry) override;
+    uint64_t run(uint64_t maxInstructions) override;
+    void step() override { run(1); }
+    std::vector<uint8_t> saveState() const override;
+    bool restoreState(const std::vector<uint8_t>& saved) override;
+
+private:
+    friend struct X86Ops;
+
+    FiscVpu& vpu;
+    X86State state;
+    std::string console;
+
+    void consoleOutput(char ch);
+    void flushConsole();
+    void syncProgramCounter();
+};
+
+// 8086/80186 real-mode core. Instructions are decoded straight from guest
+// memory through a 256-entry opcode table whose attributes say whether a
+// ModRM byte follows; prefixes are table entries too. Addresses are
+// segment * 16 + offset, wrapped to 1 MiB; reads beyond guest RAM return
+// all ones and writes there are dropped.
+struct X86Ops {
+    using S = X86State;
+    using Flags = X86State::FlagOp;
+    using OpClass = FiscVpu::OpClass;
+
+    struct Cpu;
+    using Handler = void (*)(Cpu& c);
+    enum : uint8_t { MODRM = 1, PREFIX = 2 };
+    struct Opcode {
+        Handler handler;
+        uint8_t attributes;
+        OpClass opClass;
+    };
+    using Table = std::array<Opcode, 256>;
+
+    struct Cpu {
+        X86Core& core;
+        FiscVpu& vpu;
+        X86State& s;
+        uint8_t* mem;
+        uint32_t limit;  // Guest RAM below 1 MiB
+        const Table& table;
+
+        // Instruction being executed
+        uint16_t startIp;  // Including prefixes
+        uint8_t opcode;
+        int8_t segOverride;  // -1 for the default segment
+        uint8_t rep;         // 0, 0xf2 (REPNE) or 0xf3 (REP/REPE)
+        uint8_t mod;
+        uint8_t reg;
+        uint8_t rm;
+        uint8_t eaSeg;
+        uint16_t eaOffset;
+    };
+
+    // Memory
+    static uint32_t linear(const Cpu& c, uint8_t seg, uint16_t offset) {
+        return RealModeBus::wrap((static_cast<uint32_t>(c.s.segs[seg]) << 4) + offset);
+    }
+    static uint8_t readByte(const Cpu& c, uint32_t address) {
+        return address < c.limit ? c.mem[address] : 0xff;
+    }
+    static void writeByte(Cpu& c, uint32_t address, uint8_t value) {
+        if (address < c.limit) {
+            c.mem[address] = value;
+        }
+    }
+    static uint8_t read8(const Cpu& c, uint8_t seg, uint16_t offset) {
+        return readByte(c, linear(c, seg, offset));
+    }
+    static void write8(Cpu& c, uint8_t seg, uint16_t offset, uint8_t value) {
+        writeByte(c, linear(c, seg, offset), value);
+    }
+    static uint16_t read16(const Cpu& c, uint8_t seg, uint16_t offset) {
+        uint32_t address = linear(c, seg, offset);
+        if (offset != 0xffff && address + 1 < c.limit) {
+            return RealModeBus::load<uint16_t>(c.mem + address);
+        }
+        // A word at offset 0xffff wraps within its segment
+        return readByte(c, address) | (read8(c, seg, offset + 1) << 8);
+    }
+    static void write16(Cpu& c, uint8_t seg, uint16_t offset, uint16_t value) {
+        uint32_t address = linear(c, seg, offset);
+        if (offset != 0xffff && address + 1 < c.limit) {
+            RealModeBus::store<uint16_t>(c.mem + address, value);
+            return;
+        }
+        writeByte(c, address, static_cast<uint8_t>(value));
+        write8(c, seg, offset + 1, static_cast<uint8_t>(value >> 8));
+    }
+
+    static uint8_t fetch8(Cpu& c) {
+        return read8(c, S::CS, c.s.ip++);
+    }
+    static uint16_t fetch16(Cpu& c) {
+        uint16_t value = read16(c, S::CS, c.s.ip);
+        c.s.ip += 2;
+        return value;
+    }
+
+    static void push(Cpu& c, uint16_t value) {
+        c.s.regs[S::SP] -= 2;
+        write16(c, S::SS, c.s.regs[S::SP], value);
+    }
+    static uint16_t pop(Cpu& c) {
+        uint16_t value = read16(c, S::SS, c.s.regs[S::SP]);
+        c.s.regs[S::SP] += 2;
+        return value;
+    }
+
+    static uint8_t dataSegment(const Cpu& c) {
+        return c.segOverride >= 0 ? static_cast<uint8_t>(c.segOverride) : static_cast<uint8_t>(S::DS);
+    }
+
+    // Registers and ModRM operands
+    template <bool Wide>
+    static uint32_t getReg(const Cpu& c, uint8_t r) {
+        if (Wide) {
+            return c.s.regs[r];
+        }
+        return r < 4 ? c.s.regs[r] & 0xff : c.s.regs[r - 4] >> 8;
+    }
+    template <bool Wide>
+    static void setReg(Cpu& c, uint8_t r, uint32_t value) {
+        if (Wide) {
+            c.s.regs[r] = static_cast<uint16_t>(value);
+        } else if (r < 4) {
+            c.s.regs[r] = (c.s.regs[r] & 0xff00) | (value & 0xff);
+        } else {
+            c.s.regs[r - 4] = (c.s.regs[r - 4] & 0x00ff) | ((value & 0xff) << 8);
+        }
+    }
+
+    static void decodeModrm(Cpu& c) {
+        static constexpr uint8_t NONE = 8;
+        static constexpr uint8_t base[8] = {S::BX, S::BX, S::BP, S::BP, S::SI, S::DI, S::BP, S::BX};
+        static constexpr uint8_t index[8] = {S::SI, S::DI, S::SI, S::DI, NONE, NONE, NONE, NONE};
+
+        const uint8_t modrm = fetch8(c);
+        c.mod = modrm >> 6;
+        c.reg = (modrm >> 3) & 7;
+        c.rm = modrm & 7;
+        if (c.mod == 3) {
+            return;
+        }
+
+        uint16_t offset;
+        uint8_t seg = S::DS;
+        if (c.mod == 0 && c.rm == 6) {
+            offset = fetch16(c);
+        } else {
+            offset = c.s.regs[base[c.rm]];
+            if (index[c.rm] != NONE) {
+                offset += c.s.regs[index[c.rm]];
+            }
+            if (base[c.rm] == S::BP) {
+                seg = S::SS;
+            }
+            if (c.mod == 1) {
+                offset += static_cast<int8_t>(fetch8(c));
+            } else if (c.mod == 2) {
+                offset += fetch16(c);
+            }
+        }
+        c.eaOffset = offset;
+        c.eaSeg = c.segOverride >= 0 ? static_cast<uint8_t>(c.segOverride) : seg;
+    }
+
+    template <bool Wide>
+    static uint32_t readRm(const Cpu& c) {
+        if (c.mod == 3) {
+            return getReg<Wide>(c, c.rm);
+        }
+        return Wide ? read16(c, c.eaSeg, c.eaOffset) : read8(c, c.eaSeg, c.eaOffset);
+    }
+    template <bool Wide>
+    static void writeRm(Cpu& c, uint32_t value) {
+        if (c.mod == 3) {
+            setReg<Wide>(c, c.rm, value);
+        } else if (Wide) {
+            write16(c, c.eaSeg, c.eaOffset, static_cast<uint16_t>(value));
+        } else {
+            write8(c, c.eaSeg, c.eaOffset, static_cast<uint8_t>(value));
+        }
+    }
+
+    // Lazy flags
+    static constexpr uint32_t mask(bool wide) { return wide ? 0xffff : 0xff; }
+    static constexpr uint32_t signBit(bool wide) { return wide ? 0x8000 : 0x80; }
+
+    static void setFlags(Cpu& c, Flags op, bool wide, uint32_t result, uint32_t dst, uint32_t src) {
+        c.s.flagOp = op;
+        c.s.flagWide = wide;
+        c.s.flagResult = result;
+        c.s.flagDst = dst;
+        c.s.flagSrc = src;
+    }
+
+    static bool carry(const X86State& s) {
+        const uint32_t bits = s.flagWide ? 16 : 8;
+        switch (s.flagOp) {
+            case Flags::Add:
+            case Flags::Adc:
+            case Flags::Sub:
+            case Flags::Sbb:
+                return (s.flagResult & ~mask(s.flagWide)) != 0;
+            case Flags::Logic:
+                return false;
+            case Flags::Shl:
+                return s.flagSrc <= bits && ((s.flagDst >> (bits - s.flagSrc)) & 1);
+            case Flags::Shr:
+                return s.flagSrc <= bits && ((s.flagDst >> (s.flagSrc - 1)) & 1);
+            case Flags::Sar:
+                return s.flagSrc > bits ? (s.flagDst & signBit(s.flagWide)) != 0
+                                        : ((s.flagDst >> (s.flagSrc - 1)) & 1) != 0;
+            default:
+                return s.flags & FLAG_CF;
+        }
+    }
+    static bool zero(const X86State& s) {
+        return s.flagOp == Flags::None ? (s.flags & FLAG_ZF) : (s.flagResult & mask(s.flagWide)) == 0;
+    }
+    static bool sign(const X86State& s) {
+        return s.flagOp == Flags::None ? (s.flags & FLAG_SF) : (s.flagResult & signBit(s.flagWide)) != 0;
+    }
+    static bool parity(const X86State& s) {
+        return s.flagOp == Flags::None ? (s.flags & FLAG_PF) : parityEven(s.flagResult);
+    }
+    static bool auxiliary(const X86State& s) {
+        switch (s.flagOp) {
+            case Flags::None:
+                return s.flags & FLAG_AF;
+            case Flags::Add:
+            case Flags::Adc:
+            case Flags::Sub:
+            case Flags::Sbb:
+            case Flags::Inc:
+            case Flags::Dec:
+                return ((s.flagDst ^ s.flagSrc ^ s.flagResult) & 0x10) != 0;
+            default:
+                return false;
+        }
+    }
+    static bool overflow(const X86State& s) {
+        const uint32_t top = signBit(s.flagWide);
+        switch (s.flagOp) {
+            case Flags::None:
+                return s.flags & FLAG_OF;
+            case Flags::Add:
+            case Flags::Adc:
+            case Flags::Inc:
+                return ((s.flagDst ^ s.flagResult) & (s.flagSrc ^ s.flagResult) & top) != 0;
+            case Flags::Sub:
+            case Flags::Sbb:
+            case Flags::Dec:
+                return ((s.flagDst ^ s.flagSrc) & (s.flagDst ^ s.flagResult) & top) != 0;
+            case Flags::Shl:
+                return carry(s) != ((s.flagResult & top) != 0);
+            case Flags::Shr:
+                return (s.flagDst & top) != 0;
+            default:
+                return false;
+        }
+    }
+
+    static uint16_t flagsWord(const X86State& s) {
+        if (s.flagOp == Flags::None) {
+            return s.flags;
+        }
+        return (s.flags & ~ARITHMETIC_FLAGS) |
+               (carry(s) ? FLAG_CF : 0) | (parity(s) ? FLAG_PF : 0) |
+               (auxiliary(s) ? FLAG_AF : 0) | (zero(s) ? FLAG_ZF : 0) |
+               (sign(s) ? FLAG_SF : 0) | (overflow(s) ? FLAG_OF : 0);
+    }
+    static void materialize(Cpu& c) {
+        c.s.flags = flagsWord(c.s);
+        c.s.flagOp = Flags::None;
+    }
+    static void setFlag(Cpu& c, uint16_t flag, bool value) {
+        materialize(c);
+        c.s.flags = value ? (c.s.flags | flag) : (c.s.flags & ~flag);
+    }
+    // INC and DEC leave CF alone, so it moves into flags before they record
+    static void keepCarry(Cpu& c) {
+        c.s.flags = (c.s.flags & ~FLAG_CF) | (carry(c.s) ? FLAG_CF : 0);
+    }
+    // Result flags from value, CF and OF given explicitly
+    static void setResultFlags(Cpu& c, bool wide, uint32_t value, bool cf, bool of) {
+        setFlags(c, Flags::Logic, wide, value, 0, 0);
+        materialize(c);
+        c.s.flags = (c.s.flags & ~(FLAG_CF | FLAG_OF)) | (cf ? FLAG_CF : 0) | (of ? FLAG_OF : 0);
+    }
+
+    static bool condition(const X86State& s, uint8_t cc) {
+        bool result;
+        if (s.flagOp == Flags::Sub && (cc >> 1) != 5) {
+            // After CMP/SUB most conditions are a direct compare of the operands
+            const uint32_t m = mask(s.flagWide);
+            const uint32_t dst = s.flagDst & m;
+            const uint32_t src = s.flagSrc & m;
+            const uint32_t flip = signBit(s.flagWide);
+            switch (cc >> 1) {
+                case 0: result = overflow(s); break;
+                case 1: result = dst < src; break;
+                case 2: result = dst == src; break;
+                case 3: result = dst <= src; break;
+                case 4: result = sign(s); break;
+                case 6: result = (dst ^ flip) < (src ^ flip); break;
+                default: result = (dst ^ flip) <= (src ^ flip); break;
+            }
+            return result != (cc & 1);
+        }
+        switch (cc >> 1) {
+            case 0: result = overflow(s); break;
+            case 1: result = carry(s); break;
+            case 2: result = zero(s); break;
+            case 3: result = carry(s) || zero(s); break;
+            case 4: result = sign(s); break;
+            case 5: result = parity(s); break;
+            case 6: result = sign(s) != overflow(s); break;
+            default: result = zero(s) || sign(s) != overflow(s); break;
+        }
+        return result != (cc & 1);
+    }
+
+    // ADD OR ADC SBB AND SUB XOR CMP, in encoding order
+    template <int Op, bool Wide>
+    static uint32_t alu(Cpu& c, uint32_t dst, uint32_t src) {
+        uint32_t result;
+        switch (Op) {
+            case 0:
+                result = dst + src;
+                setFlags(c, Flags::Add, Wide, result, dst, src);
+                break;
+            case 1:
+                result = dst | src;
+                setFlags(c, Flags::Logic, Wide, result, dst, src);
+                break;
+            case 2:
+                result = dst + src + carry(c.s);
+                setFlags(c, Flags::Adc, Wide, result, dst, src);
+                break;
+            case 3:
+                result = dst - src - carry(c.s);
+                setFlags(c, Flags::Sbb, Wide, result, dst, src);
+                break;
+            case 4:
+                result = dst & src;
+                setFlags(c, Flags::Logic, Wide, result, dst, src);
+                break;
+            case 6:
+                result = dst ^ src;
+                setFlags(c, Flags::Logic, Wide, result, dst, src);
+                break;
+            default:
+                result = dst - src;
+                setFlags(c, Flags::Sub, Wide, result, dst, src);
+                break;
+        }
+        return result & mask(Wide);
+    }
+    template <bool Wide>
+    static uint32_t aluOp(Cpu& c, uint8_t op, uint32_t dst, uint32_t src) {
+        switch (op) {
+            case 0: return alu<0, Wide>(c, dst, src);
+            case 1: return alu<1, Wide>(c, dst, src);
+            case 2: return alu<2, Wide>(c, dst, src);
+            case 3: return alu<3, Wide>(c, dst, src);
+            case 4: return alu<4, Wide>(c, dst, src);
+            case 5: return alu<5, Wide>(c, dst, src);
+            case 6: return alu<6, Wide>(c, dst, src);
+            default: return alu<7, Wide>(c, dst, src);
+        }
+    }
+
+    template <bool Wide>
+    static uint32_t incDec(Cpu& c, uint32_t value, bool decrement) {
+        keepCarry(c);
+        uint32_t result = decrement ? value - 1 : value + 1;
+        setFlags(c, decrement ? Flags::Dec : Flags::Inc, Wide, result, value, 1);
+        return result & mask(Wide);
+    }
+
+    // ROL ROR RCL RCR SHL SHR SAL SAR
+    template <bool Wide>
+    static uint32_t shift(Cpu& c, uint8_t op, uint32_t value, uint32_t count) {
+        constexpr uint32_t bits = Wide ? 16 : 8;
+        constexpr uint32_t m = mask(Wide);
+        constexpr uint32_t top = signBit(Wide);
+        uint32_t result = value;
+        switch (op) {
+            case 0: {
+                const uint32_t n = count % bits;
+                result = ((value << n) | (value >> (bits - n))) & m;
+                const bool cf = result & 1;
+                setFlag(c, FLAG_CF, cf);
+                setFlag(c, FLAG_OF, ((result & top) != 0) != cf);
+                break;
+            }
+            case 1: {
+                const uint32_t n = count % bits;
+                result = ((value >> n) | (value << (bits - n))) & m;
+                setFlag(c, FLAG_CF, (result & top) != 0);
+                setFlag(c, FLAG_OF, (((result << 1) ^ result) & top) != 0);
+                break;
+            }
+            case 2: {
+                bool cf = carry(c.s);
+                for (uint32_t n = count % (bits + 1); n > 0; --n) {
+                    const bool out = result & top;
+                    result = ((result << 1) | cf) & m;
+                    cf = out;
+                }
+                setFlag(c, FLAG_CF, cf);
+                setFlag(c, FLAG_OF, ((result & top) != 0) != cf);
+                break;
+            }
+            case 3: {
+                bool cf = carry(c.s);
+                for (uint32_t n = count % (bits + 1); n > 0; --n) {
+                    const bool out = result & 1;
+                    result = (result >> 1) | (cf ? top : 0);
+                    cf = out;
+                }
+                setFlag(c, FLAG_CF, cf);
+                setFlag(c, FLAG_OF, (((result << 1) ^ result) & top) != 0);
+                break;
+            }
+            case 5:
+                result = count < bits ? value >> count : 0;
+                setFlags(c, Flags::Shr, Wide, result, value, count);
+                break;
+            case 7: {
+                const uint32_t extended = (value & top) ? value | ~m : value;
+                result = static_cast<uint32_t>(static_cast<int32_t>(extended) >>
+                                               std::min<uint32_t>(count, 31)) & m;
+                setFlags(c, Flags::Sar, Wide, result, value, count);
+                break;
+            }
+            default:
+                result = count < 32 ? value << count : 0;
+                setFlags(c, Flags::Shl, Wide, result, value, count);
+                break;
+        }
+        return result & m;
+    }
+
+    // Interrupts, and the BIOS/DOS services answered for unset vectors
+    static std::string here(const Cpu& c) {
+        return farAddress(c.s.segs[S::CS], c.startIp);
+    }
+
+    static void fault(Cpu& c, const std::string& reason) {
+        c.core.flushConsole();
+        c.vpu.trap(reason);
+    }
+
+    static void interrupt(Cpu& c, uint8_t vector) {
+        const uint32_t entry = vector * 4u;
+        const uint16_t offset = readByte(c, entry) | (readByte(c, entry + 1) << 8);
+        const uint16_t segment = readByte(c, entry + 2) | (readByte(c, entry + 3) << 8);
+        if (offset == 0 && segment == 0) {
+            service(c, vector);
+            return;
+        }
+        push(c, flagsWord(c.s) | FIXED_FLAGS);
+        c.s.flags &= ~(FLAG_IF | FLAG_TF);
+        push(c, c.s.segs[S::CS]);
+        push(c, c.s.ip);
+        c.s.segs[S::CS] = segment;
+        c.s.ip = offset;
+    }
+
+    // Faults return to the faulting instruction on the 80186, after it on the 8086
+    static void exception(Cpu& c, uint8_t vector) {
+        if (c.s.has186) {
+            c.s.ip = c.startIp;
+        }
+        interrupt(c, vector);
+    }
+
+    static void exitProgram(Cpu& c, uint8_t code) {
+        c.core.flushConsole();
+        c.vpu.emit("Program exited with code " + std::to_string(code));
+        c.vpu.exitGuest(code);
+    }
+
+    static void service(Cpu& c, uint8_t vector) {
+        X86State& s = c.s;
+        const uint8_t ah = s.regs[S::AX] >> 8;
+        const uint8_t al = s.regs[S::AX] & 0xff;
+        switch (vector) {
+            case 0x00:
+                fault(c, "Divide error at " + here(c));
+                return;
+            case 0x03:
+                fault(c, "Breakpoint at " + here(c));
+                return;
+            case 0x06:
+                fault(c, "Invalid opcode " + hex8(c.opcode) + " at " + here(c));
+                return;
+            case 0x10:
+                // Video: teletype output and mode query; other calls are ignored
+                if (ah == 0x0e) {
+                    c.core.consoleOutput(static_cast<char>(al));
+                } else if (ah == 0x0f) {
+                    s.regs[S::AX] = 0x5003;  // 80 columns, mode 3
+                    s.regs[S::BX] &= 0x00ff;
+                }
+                return;
+            case 0x20:
+                exitProgram(c, 0);
+                return;
+            case 0x21:
+                switch (ah) {
+                    case 0x00:
+                        exitProgram(c, 0);
+                        return;
+                    case 0x02:
+                        c.core.consoleOutput(static_cast<char>(s.regs[S::DX] & 0xff));
+                        return;
+                    case 0x09: {
+                        uint16_t offset = s.regs[S::DX];
+                        for (uint32_t n = 0; n < 0x10000; ++n, ++offset) {
+                            const char ch = static_cast<char>(read8(c, S::DS, offset));
+                            if (ch == '$') {
+                                break;
+                            }
+                            c.core.consoleOutput(ch);
+                        }
+                        return;
+                    }
+                    case 0x30:
+                        s.regs[S::AX] = 0x0005;  // DOS 5.0
+                        return;
+                    case 0x4c:
+                        exitProgram(c, al);
+                        return;
+                    default:
+                        fault(c, "Unsupported DOS function " + hex8(ah) + " at " + here(c));
+                        return;
+                }
+            default:
+                fault(c, "Unhandled interrupt " + hex8(vector) + " at " + here(c));
+                return;
+        }
+    }
+
+    // Prefixes
+    static void opSegmentPrefix(Cpu& c) {
+        c.segOverride = (c.opcode >> 3) & 3;
+    }
+    static void opRepPrefix(Cpu& c) {
+        c.rep = c.opcode;
+    }
+    static void opLockPrefix(Cpu&) {
+    }
+
+    static void opIllegal(Cpu& c) {
+        if (c.s.has186) {
+            exception(c, 6);
+            return;
+        }
+        fault(c, "Illegal instruction " + hex8(c.opcode) + " at " + here(c));
+    }
+
+    // Arithmetic and logic
+    // Form: 0 rm8,r8  1 rm16,r16  2 r8,rm8  3 r16,rm16  4 AL,imm8  5 AX,imm16
+    template <int Op, int Form>
+    static void opAlu(Cpu& c) {
+        constexpr bool wide = Form & 1;
+        if (Form < 2) {
+            uint32_t result = alu<Op, wide>(c, readRm<wide>(c), getReg<wide>(c, c.reg));
+            if (Op != 7) {
+                writeRm<wide>(c, result);
+            }
+        } else if (Form < 4) {
+            uint32_t result = alu<Op, wide>(c, getReg<wide>(c, c.reg), readRm<wide>(c));
+            if (Op != 7) {
+                setReg<wide>(c, c.reg, result);
+            }
+        } else {
+            uint32_t imm = wide ? fetch16(c) : fetch8(c);
+            uint32_t result = alu<Op, wide>(c, getReg<wide>(c, S::AX), imm);
+            if (Op != 7) {
+                setReg<wide>(c, S::AX, result);
+            }
+        }
+    }
+
+    // 80-83: 0 rm8,imm8  1 rm16,imm16  2 rm8,imm8  3 rm16,sign-extended imm8
+    template <int Form>
+    static void opGroup1(Cpu& c) {
+        constexpr bool wide = Form & 1;
+        uint32_t dst = readRm<wide>(c);
+        uint32_t src = Form == 1 ? fetch16(c)
+                     : Form == 3 ? static_cast<uint16_t>(static_cast<int8_t>(fetch8(c)))
+                     : fetch8(c);
+        uint32_t result = aluOp<wide>(c, c.reg, dst, src);
+        if (c.reg != 7) {
+            writeRm<wide>(c, result);
+        }
+    }
+
+    template <bool Wide>
+    static void opTest(Cpu& c) {
+        alu<4, Wide>(c, readRm<Wide>(c), getReg<Wide>(c, c.reg));
+    }
+    template <bool Wide>
+    static void opTestAccumulator(Cpu& c) {
+        uint32_t imm = Wide ? fetch16(c) : fetch8(c);
+        alu<4, Wide>(c, getReg<Wide>(c, S::AX), imm);
+    }
+
+    static void opIncReg(Cpu& c) {
+        uint8_t r = c.opcode & 7;
+        c.s.regs[r] = static_cast<uint16_t>(incDec<true>(c, c.s.regs[r], c.opcode & 8));
+    }
+
+    // D0-D3 and C0/C1: the shift count comes from 1, CL or an immediate
+    enum CountSource { COUNT_ONE, COUNT_CL, COUNT_IMM };
+    template <bool Wide, CountSource Source>
+    static void opGroup2(Cpu& c) {
+        uint32_t value = readRm<Wide>(c);
+        uint32_t count = Source == COUNT_ONE ? 1 : Source == COUNT_CL ? c.s.regs[S::CX] & 0xff : fetch8(c);
+        if (c.s.has186) {
+            count &= 0x1f;
+        }
+        if (count == 0) {
+            return;
+        }
+        writeRm<Wide>(c, shift<Wide>(c, c.reg, value, count));
+    }
+
+    static void divideError(Cpu& c) {
+        exception(c, 0);
+    }
+
+    // F6/F7: TEST NOT NEG MUL IMUL DIV IDIV
+    template <bool Wide>
+    static void opGroup3(Cpu& c) {
+        constexpr uint32_t m = mask(Wide);
+        X86State& s = c.s;
+        uint32_t value = readRm<Wide>(c);
+        switch (c.reg) {
+            case 0:
+            case 1:
+                alu<4, Wide>(c, value, Wide ? fetch16(c) : fetch8(c));
+                return;
+            case 2:
+                writeRm<Wide>(c, ~value & m);
+                return;
+            case 3:
+                writeRm<Wide>(c, alu<5, Wide>(c, 0, value));
+                return;
+            case 4: {
+                if (Wide) {
+                    uint32_t product = s.regs[S::AX] * value;
+                    s.regs[S::AX] = static_cast<uint16_t>(product);
+                    s.regs[S::DX] = static_cast<uint16_t>(product >> 16);
+                    setResultFlags(c, true, product, product >> 16, product >> 16);
+                } else {
+                    uint32_t product = (s.regs[S::AX] & 0xff) * value;
+                    s.regs[S::AX] = static_cast<uint16_t>(product);
+                    setResultFlags(c, false, product, product >> 8, product >> 8);
+                }
+                return;
+            }
+            case 5: {
+                if (Wide) {
+                    int32_t product = static_cast<int16_t>(s.regs[S::AX]) * static_cast<int16_t>(value);
+                    s.regs[S::AX] = static_cast<uint16_t>(product);
+                    s.regs[S::DX] = static_cast<uint16_t>(static_cast<uint32_t>(product) >> 16);
+                    bool spill = product != static_cast<int16_t>(product);
+                    setResultFlags(c, true, static_cast<uint32_t>(product), spill, spill);
+                } else {
+                    int32_t product = static_cast<int8_t>(s.regs[S::AX]) * static_cast<int8_t>(value);
+                    s.regs[S::AX] = static_cast<uint16_t>(product);
+                    bool spill = product != static_cast<int8_t>(product);
+                    setResultFlags(c, false, static_cast<uint32_t>(product), spill, spill);
+                }
+                return;
+            }
+            case 6: {
+                if (value == 0) {
+                    divideError(c);
+                    return;
+                }
+                if (Wide) {
+                    uint32_t dividend = (static_cast<uint32_t>(s.regs[S::DX]) << 16) | s.regs[S::AX];
+                    uint32_t quotient = dividend / value;
+                    if (quotient > 0xffff) {
+                        divideError(c);
+                        return;
+                    }
+                    s.regs[S::AX] = static_cast<uint16_t>(quotient);
+                    s.regs[S::DX] = static_cast<uint16_t>(dividend % value);
+                } else {
+                    uint32_t dividend = s.regs[S::AX];
+                    uint32_t quotient = dividend / value;
+                    if (quotient > 0xff) {
+                        divideError(c);
+                        return;
+                    }
+                    s.regs[S::AX] = static_cast<uint16_t>(((dividend % value) << 8) | quotient);
+                }
+                return;
+            }
+            default: {
+                if (value == 0) {
+                    divideError(c);
+                    return;
+                }
+                if (Wide) {
+                    int32_t dividend = static_cast<int32_t>((static_cast<uint32_t>(s.regs[S::DX]) << 16) |
+                                                            s.regs[S::AX]);
+                    int32_t divisor = static_cast<int16_t>(value);
+                    if (dividend == INT32_MIN && divisor == -1) {
+                        divideError(c);
+                        return;
+                    }
+                    int32_t quotient = dividend / divisor;
+                    if (quotient < -32768 || quotient > 32767) {
+                        divideError(c);
+                        return;
+                    }
+                    s.regs[S::AX] = static_cast<uint16_t>(quotient);
+                    s.regs[S::DX] = static_cast<uint16_t>(dividend % divisor);
+                } else {
+                    int32_t dividend = static_cast<int16_t>(s.regs[S::AX]);
+                    int32_t divisor = static_cast<int8_t>(value);
+                    int32_t quotient = dividend / divisor;
+                    if (quotient < -128 || quotient > 127) {
+                        divideError(c);
+                        return;
+                    }
+                    s.regs[S::AX] = static_cast<uint16_t>(((dividend % divisor) & 0xff) << 8 |
+                                                          (quotient & 0xff));
+                }
+                return;
+            }
+        }
+    }
+
+    // FE: INC/DEC rm8
+    static void opGroup4(Cpu& c) {
+        if (c.reg > 1) {
+            opIllegal(c);
+            return;
+        }
+        writeRm<false>(c, incDec<false>(c, readRm<false>(c), c.reg == 1));
+    }
+
+    // FF: INC DEC CALL CALLF JMP JMPF PUSH
+    static void opGroup5(Cpu& c) {
+        X86State& s = c.s;
+        switch (c.reg) {
+            case 0:
+            case 1:
+                writeRm<true>(c, incDec<true>(c, readRm<true>(c), c.reg == 1));
+                return;
+            case 2: {
+                uint16_t target = static_cast<uint16_t>(readRm<true>(c));
+                push(c, s.ip);
+                s.ip = target;
+                return;
+            }
+            case 4:
+                s.ip = static_cast<uint16_t>(readRm<true>(c));
+                return;
+            case 3:
+            case 5: {
+                if (c.mod == 3) {
+                    opIllegal(c);
+                    return;
+                }
+                uint16_t offset = read16(c, c.eaSeg, c.eaOffset);
+                uint16_t segment = read16(c, c.eaSeg, c.eaOffset + 2);
+                if (c.reg == 3) {
+                    push(c, s.segs[S::CS]);
+                    push(c, s.ip);
+                }
+                s.segs[S::CS] = segment;
+                s.ip = offset;
+                return;
+            }
+            case 7:
+                if (s.has186) {
+                    opIllegal(c);
+                    return;
+                }
+                [[fallthrough]];
+            default: {
+                // PUSH SP stores the decremented value on the 8086/80186
+                uint16_t value = static_cast<uint16_t>(readRm<true>(c));
+                if (c.mod == 3 && c.rm == S::SP) {
+                    value -= 2;
+                }
+                push(c, value);
+                return;
+            }
+        }
+    }
+
+    static void opImul(Cpu& c) {
+        int32_t imm = c.opcode == 0x69 ? static_cast<int16_t>(fetch16(c)) : static_cast<int8_t>(fetch8(c));
+        int32_t product = static_cast<int16_t>(readRm<true>(c)) * imm;
+        c.s.regs[c.reg] = static_cast<uint16_t>(product);
+        bool spill = product != static_cast<int16_t>(product);
+        setResultFlags(c, true, static_cast<uint32_t>(product), spill, spill);
+    }
+
+    // Decimal adjust
+    static void opDaa(Cpu& c) {
+        materialize(c);
+        X86State& s = c.s;
+        const uint8_t oldAl = s.regs[S::AX] & 0xff;
+        const bool oldCf = s.flags & FLAG_CF;
+        uint8_t al = oldAl;
+        bool af = false;
+        if ((al & 0x0f) > 9 || (s.flags & FLAG_AF)) {
+            al += 6;
+            af = true;
+        }
+        const bool cf = oldAl > 0x99 || oldCf;
+        if (cf) {
+            al += 0x60;
+        }
+        setReg<false>(c, S::AX, al);
+        setResultFlags(c, false, al, cf, false);
+        setFlag(c, FLAG_AF, af);
+    }
+
+    static void opDas(Cpu& c) {
+        materialize(c);
+        X86State& s = c.s;
+        const uint8_t oldAl = s.regs[S::AX] & 0xff;
+        const bool oldCf = s.flags & FLAG_CF;
+        uint8_t al = oldAl;
+        bool cf = false;
+        bool af = false;
+        if ((al & 0x0f) > 9 || (s.flags & FLAG_AF)) {
+            cf = oldCf || al < 6;
+            al -= 6;
+            af = true;
+        }
+        if (oldAl > 0x99 || oldCf) {
+            al -= 0x60;
+            cf = true;
+        }
+        setReg<false>(c, S::AX, al);
+        setResultFlags(c, false, al, cf, false);
+        setFlag(c, FLAG_AF, af);
+    }
+
+    // AAA (0x37) and AAS (0x3f)
+    static void opAsciiAdjust(Cpu& c) {
+        materialize(c);
+        X86State& s = c.s;
+        uint8_t al = s.regs[S::AX] & 0xff;
+        uint8_t ah = s.regs[S::AX] >> 8;
+        const bool adjust = (al & 0x0f) > 9 || (s.flags & FLAG_AF);
+        if (adjust) {
+            if (c.opcode == 0x37) {
+                al += 6;
+                ++ah;
+            } else {
+                al -= 6;
+                --ah;
+            }
+        }
+        s.regs[S::AX] = static_cast<uint16_t>((ah << 8) | (al & 0x0f));
+        s.flags = (s.flags & ~(FLAG_AF | FLAG_CF)) | (adjust ? FLAG_AF | FLAG_CF : 0);
+    }
+
+    static void opAam(Cpu& c) {
+        uint8_t base = fetch8(c);
+        if (base == 0) {
+            divideError(c);
+            return;
+        }
+        uint8_t al = c.s.regs[S::AX] & 0xff;
+        c.s.regs[S::AX] = static_cast<uint16_t>(((al / base) << 8) | (al % base));
+        setFlags(c, Flags::Logic, false, al % base, 0, 0);
+    }
+
+    static void opAad(Cpu& c) {
+        uint8_t base = fetch8(c);
+        uint8_t al = static_cast<uint8_t>((c.s.regs[S::AX] & 0xff) + (c.s.regs[S::AX] >> 8) * base);
+        c.s.regs[S::AX] = al;
+        setFlags(c, Flags::Logic, false, al, 0, 0);
+    }
+
+    static void opSalc(Cpu& c) {
+        setReg<false>(c, S::AX, carry(c.s) ? 0xff : 0);
+    }
+
+    static void opCbw(Cpu& c) {
+        c.s.regs[S::AX] = static_cast<uint16_t>(static_cast<int8_t>(c.s.regs[S::AX] & 0xff));
+    }
+    static void opCwd(Cpu& c) {
+        c.s.regs[S::DX] = (c.s.regs[S::AX] & 0x8000) ? 0xffff : 0;
+    }
+
+    // Data movement
+    template <bool Wide>
+    static void opMovToRm(Cpu& c) {
+        writeRm<Wide>(c, getReg<Wide>(c, c.reg));
+    }
+    template <bool Wide>
+    static void opMovFromRm(Cpu& c) {
+        setReg<Wide>(c, c.reg, readRm<Wide>(c));
+    }
+    template <bool Wide>
+    static void opMovRmImm(Cpu& c) {
+        writeRm<Wide>(c, Wide ? fetch16(c) : fetch8(c));
+    }
+    static void opMovRegImm8(Cpu& c) {
+        setReg<false>(c, c.opcode & 7, fetch8(c));
+    }
+    static void opMovRegImm16(Cpu& c) {
+        c.s.regs[c.opcode & 7] = fetch16(c);
+    }
+    // A0-A3: accumulator to or from a direct address
+    template <bool Wide, bool Store>
+    static void opMovOffset(Cpu& c) {
+        uint16_t offset = fetch16(c);
+        uint8_t seg = dataSegment(c);
+        if (Store) {
+            if (Wide) {
+                write16(c, seg, offset, c.s.regs[S::AX]);
+            } else {
+                write8(c, seg, offset, c.s.regs[S::AX] & 0xff);
+            }
+        } else {
+            setReg<Wide>(c, S::AX, Wide ? read16(c, seg, offset) : read8(c, seg, offset));
+        }
+    }
+    static void opMovFromSegment(Cpu& c) {
+        writeRm<true>(c, c.s.segs[c.reg & 3]);
+    }
+    static void opMovToSegment(Cpu& c) {
+        c.s.segs[c.reg & 3] = static_cast<uint16_t>(readRm<true>(c));
+    }
+    static void opLea(Cpu& c) {
+        if (c.mod == 3) {
+            opIllegal(c);
+            return;
+        }
+        c.s.regs[c.reg] = c.eaOffset;
+    }
+    // LES (0xc4) and LDS (0xc5)
+    static void opLoadFarPointer(Cpu& c) {
+        if (c.mod == 3) {
+            opIllegal(c);
+            return;
+        }
+        c.s.regs[c.reg] = read16(c, c.eaSeg, c.eaOffset);
+        c.s.segs[c.opcode == 0xc4 ? S::ES : S::DS] = read16(c, c.eaSeg, c.eaOffset + 2);
+    }
+    template <bool Wide>
+    static void opXchg(Cpu& c) {
+        uint32_t value = readRm<Wide>(c);
+        writeRm<Wide>(c, getReg<Wide>(c, c.reg));
+        setReg<Wide>(c, c.reg, value);
+    }
+    static void opXchgAccumulator(Cpu& c) {
+        std::swap(c.s.regs[S::AX], c.s.regs[c.opcode & 7]);
+    }
+    static void opXlat(Cpu& c) {
+        uint16_t offset = c.s.regs[S::BX] + (c.s.regs[S::AX] & 0xff);
+        setReg<false>(c, S::AX, read8(c, dataSegment(c), offset));
+    }
+
+    // Stack
+    static void opPushReg(Cpu& c) {
+        uint8_t r = c.opcode & 7;
+        push(c, r == S::SP ? c.s.regs[S::SP] - 2 : c.s.regs[r]);
+    }
+    static void opPopReg(Cpu& c) {
+        uint16_t value = pop(c);
+        c.s.regs[c.opcode & 7] = value;
+    }
+    static void opPushSegment(Cpu& c) {
+        push(c, c.s.segs[(c.opcode >> 3) & 3]);
+    }
+    static void opPopSegment(Cpu& c) {
+        c.s.segs[(c.opcode >> 3) & 3] = pop(c);
+    }
+    static void opPopRm(Cpu& c) {
+        uint16_t value = pop(c);
+        writeRm<true>(c, value);
+    }
+    static void opPushImm(Cpu& c) {
+        push(c, c.opcode == 0x68 ? fetch16(c) : static_cast<uint16_t>(static_cast<int8_t>(fetch8(c))));
+    }
+    static void opPusha(Cpu& c) {
+        uint16_t sp = c.s.regs[S::SP];
+        for (uint8_t r = S::AX; r <= S::DI; ++r) {
+            push(c, r == S::SP ? sp : c.s.regs[r]);
+        }
+    }
+    static void opPopa(Cpu& c) {
+        for (int r = S::DI; r >= S::AX; --r) {
+            uint16_t value = pop(c);
+            if (r != S::SP) {
+                c.s.regs[r] = value;
+            }
+        }
+    }
+    static void opPushf(Cpu& c) {
+        push(c, flagsWord(c.s) | FIXED_FLAGS);
+    }
+    static void opPopf(Cpu& c) {
+        c.s.flags = pop(c) & WRITABLE_FLAGS;
+        c.s.flagOp = Flags::None;
+    }
+    static void opSahf(Cpu& c) {
+        materialize(c);
+        const uint16_t low = FLAG_CF | FLAG_PF | FLAG_AF | FLAG_ZF | FLAG_SF;
+        c.s.flags = (c.s.flags & ~low) | ((c.s.regs[S::AX] >> 8) & low);
+    }
+    static void opLahf(Cpu& c) {
+        setReg<false>(c, 4, (flagsWord(c.s) & 0xff) | 0x02);
+    }
+    static void opEnter(Cpu& c) {
+        X86State& s = c.s;
+        uint16_t size = fetch16(c);
+        uint8_t level = fetch8(c) & 0x1f;
+        push(c, s.regs[S::BP]);
+        uint16_t frame = s.regs[S::SP];
+        for (uint8_t n = 1; n < level; ++n) {
+            s.regs[S::BP] -= 2;
+            push(c, read16(c, S::SS, s.regs[S::BP]));
+        }
+        if (level > 0) {
+            push(c, frame);
+        }
+        s.regs[S::BP] = frame;
+        s.regs[S::SP] -= size;
+    }
+    static void opLeave(Cpu& c) {
+        c.s.regs[S::SP] = c.s.regs[S::BP];
+        c.s.regs[S::BP] = pop(c);
+    }
+    static void opBound(Cpu& c) {
+        if (c.mod == 3) {
+            opIllegal(c);
+            return;
+        }
+        int16_t index = static_cast<int16_t>(c.s.regs[c.reg]);
+        int16_t lower = static_cast<int16_t>(read16(c, c.eaSeg, c.eaOffset));
+        int16_t upper = static_cast<int16_t>(read16(c, c.eaSeg, c.eaOffset + 2));
+        if (index < lower || index > upper) {
+            c.s.ip = c.startIp;
+            interrupt(c, 5);
+        }
+    }
+
+    // Control transfer
+    static void takeBranch(Cpu& c, int8_t displacement) {
+        c.s.ip += displacement;
+        ++c.vpu.perf.takenBranches;
+    }
+    static void opJcc(Cpu& c) {
+        int8_t displacement = static_cast<int8_t>(fetch8(c));
+        if (condition(c.s, c.opcode & 0x0f)) {
+            takeBranch(c, displacement);
+        }
+    }
+    // E0-E3: LOOPNZ LOOPZ LOOP JCXZ
+    static void opLoop(Cpu& c) {
+        int8_t displacement = static_cast<int8_t>(fetch8(c));
+        uint16_t& cx = c.s.regs[S::CX];
+        bool taken;
+        if (c.opcode == 0xe3) {
+            taken = cx == 0;
+        } else {
+            --cx;
+            taken = cx != 0 && (c.opcode == 0xe2 || zero(c.s) == (c.opcode == 0xe1));
+        }
+        if (taken) {
+            takeBranch(c, displacement);
+        }
+    }
+    static void opJmpShort(Cpu& c) {
+        int8_t displacement = static_cast<int8_t>(fetch8(c));
+        c.s.ip += displacement;
+    }
+    static void opJmpNear(Cpu& c) {
+        uint16_t displacement = fetch16(c);
+        c.s.ip += displacement;
+    }
+    static void opCallNear(Cpu& c) {
+        uint16_t displacement = fetch16(c);
+        push(c, c.s.ip);
+        c.s.ip += displacement;
+    }
+    // 9A (CALL) and EA (JMP) far
+    static void opFarDirect(Cpu& c) {
+        uint16_t offset = fetch16(c);
+        uint16_t segment = fetch16(c);
+        if (c.opcode == 0x9a) {
+            push(c, c.s.segs[S::CS]);
+            push(c, c.s.ip);
+        }
+        c.s.segs[S::CS] = segment;
+        c.s.ip = offset;
+    }
+    // C2/C3 (and the 8086 aliases C0/C1) near, CA/CB (and C8/C9) far; the
+    // even opcodes release an immediate byte count
+    static void opRet(Cpu& c) {
+        uint16_t release = (c.opcode & 1) ? 0 : fetch16(c);
+        c.s.ip = pop(c);
+        if (c.opcode & 0x08) {
+            c.s.segs[S::CS] = pop(c);
+        }
+        c.s.regs[S::SP] += release;
+    }
+    static void opIret(Cpu& c) {
+        c.s.ip = pop(c);
+        c.s.segs[S::CS] = pop(c);
+        c.s.flags = pop(c) & WRITABLE_FLAGS;
+        c.s.flagOp = Flags::None;
+    }
+    static void opInt(Cpu& c) {
+        interrupt(c, c.opcode == 0xcc ? 3 : fetch8(c));
+    }
+    static void opInto(Cpu& c) {
+        if (overflow(c.s)) {
+            interrupt(c, 4);
+        }
+    }
+    static void opHlt(Cpu& c) {
+        // Nothing raises hardware interrupts, so HLT ends the run
+        c.core.flushConsole();
+        c.vpu.emit("CPU halted at " + here(c));
+        c.vpu.halt();
+    }
+
+    // Flag instructions: F5 CMC, F8-FD CLC STC CLI STI CLD STD
+    static void opFlagControl(Cpu& c) {
+        switch (c.opcode) {
+            case 0xf5: setFlag(c, FLAG_CF, !carry(c.s)); break;
+            case 0xf8: setFlag(c, FLAG_CF, false); break;
+            case 0xf9: setFlag(c, FLAG_CF, true); break;
+            case 0xfa: c.s.flags &= ~FLAG_IF; break;
+            case 0xfb: c.s.flags |= FLAG_IF; break;
+            case 0xfc: c.s.flags &= ~FLAG_DF; break;
+            default: c.s.flags |= FLAG_DF; break;
+        }
+    }
+
+    // Strings. REP repeats while CX is non-zero; REPE/REPNE also stop
+    // CMPS and SCAS on the first (mis)match.
+    enum StringOp { MOVS, CMPS, STOS, LODS, SCAS, INS, OUTS };
+    template <StringOp Op, bool Wide>
+    static void opString(Cpu& c) {
+        X86State& s = c.s;
+        if (c.rep && s.regs[S::CX] == 0) {
+            return;
+        }
+        const uint8_t source = dataSegment(c);
+        const int16_t delta = (s.flags & FLAG_DF) ? (Wide ? -2 : -1) : (Wide ? 2 : 1);
+        const auto load = [&c](uint8_t seg, uint16_t offset) -> uint32_t {
+            return Wide ? read16(c, seg, offset) : read8(c, seg, offset);
+        };
+        const auto store = [&c](uint8_t seg, uint16_t offset, uint32_t value) {
+            if (Wide) {
+                write16(c, seg, offset, static_cast<uint16_t>(value));
+            } else {
+                write8(c, seg, offset, static_cast<uint8_t>(value));
+            }
+        };
+        while (true) {
+            switch (Op) {
+                case MOVS:
+                    store(S::ES, s.regs[S::DI], load(source, s.regs[S::SI]));
+                    s.regs[S::SI] += delta;
+                    s.regs[S::DI] += delta;
+                    break;
+                case CMPS:
+                    alu<7, Wide>(c, load(source, s.regs[S::SI]), load(S::ES, s.regs[S::DI]));
+                    s.regs[S::SI] += delta;
+                    s.regs[S::DI] += delta;
+                    break;
+                case STOS:
+                    store(S::ES, s.regs[S::DI], getReg<Wide>(c, S::AX));
+                    s.regs[S::DI] += delta;
+                    break;
+                case LODS:
+                    setReg<Wide>(c, S::AX, load(source, s.regs[S::SI]));
+                    s.regs[S::SI] += delta;
+                    break;
+                case SCAS:
+                    alu<7, Wide>(c, getReg<Wide>(c, S::AX), load(S::ES, s.regs[S::DI]));
+                    s.regs[S::DI] += delta;
+                    break;
+                case INS:
+                    store(S::ES, s.regs[S::DI], mask(Wide));  // No devices: the bus floats high
+                    s.regs[S::DI] += delta;
+                    break;
+                case OUTS:
+                    s.regs[S::SI] += delta;
+                    break;
+            }
+            if (!c.rep) {
+                return;
+            }
+            if (--s.regs[S::CX] == 0) {
+                return;
+            }
+            if ((Op == CMPS || Op == SCAS) && zero(s) != (c.rep == 0xf3)) {
+                return;
+            }
+        }
+    }
+
+    // Port I/O: no devices are attached, so reads return all ones
+    static void opIn(Cpu& c) {
+        if (!(c.opcode & 0x08)) {
+            fetch8(c);
+        }
+        setReg<true>(c, S::AX, (c.opcode & 1) ? 0xffff : (c.s.regs[S::AX] | 0x00ff));
+    }
+    static void opOut(Cpu& c) {
+        if (!(c.opcode & 0x08)) {
+            fetch8(c);
+        }
+    }
+
+    // No coprocessor is emulated: ESC and WAIT execute as on a bare 8086,
+    // so FPU probes find nothing
+    static void opEscape(Cpu&) {
+    }
+    static void opNop(Cpu&) {
+    }
+
+    template <int Op>
+    static void addAluRow(Table& t) {
+        t[Op * 8 + 0] = {&opAlu<Op, 0>, MODRM, OpClass::Alu};
+        t[Op * 8 + 1] = {&opAlu<Op, 1>, MODRM, OpClass::Alu};
+        t[Op * 8 + 2] = {&opAlu<Op, 2>, MODRM, OpClass::Alu};
+        t[Op * 8 + 3] = {&opAlu<Op, 3>, MODRM, OpClass::Alu};
+        t[Op * 8 + 4] = {&opAlu<Op, 4>, 0, OpClass::Alu};
+        t[Op * 8 + 5] = {&opAlu<Op, 5>, 0, OpClass::Alu};
+    }
+
+    static Table buildTable(bool has186) {
+        Table t;
+        t.fill(Opcode{&opIllegal, 0, OpClass::System});
+        addAluRow<0>(t);
+        addAluRow<1>(t);
+        addAluRow<2>(t);
+        addAluRow<3>(t);
+        addAluRow<4>(t);
+        addAluRow<5>(t);
+        addAluRow<6>(t);
+        addAluRow<7>(t);
+        for (uint8_t seg = 0; seg < 4; ++seg) {
+            t[0x06 + seg * 8] = {&opPushSegment, 0, OpClass::Store};
+            t[0x07 + seg * 8] = {&opPopSegment, 0, OpClass::Load};
+            t[0x26 + seg * 8] = {&opSegmentPrefix, PREFIX, OpClass::System};
+        }
+        if (has186) {
+            t[0x0f] = {&opIllegal, 0, OpClass::System};  // POP CS was dropped
+        }
+        t[0x27] = {&opDaa, 0, OpClass::Alu};
+        t[0x2f] = {&opDas, 0, OpClass::Alu};
+        t[0x37] = {&opAsciiAdjust, 0, OpClass::Alu};
+        t[0x3f] = {&opAsciiAdjust, 0, OpClass::Alu};
+        for (uint8_t r = 0; r < 8; ++r) {
+            t[0x40 + r] = {&opIncReg, 0, OpClass::Alu};
+            t[0x48 + r] = {&opIncReg, 0, OpClass::Alu};
+            t[0x50 + r] = {&opPushReg, 0, OpClass::Store};
+            t[0x58 + r] = {&opPopReg, 0, OpClass::Load};
+            t[0x90 + r] = {&opXchgAccumulator, 0, OpClass::Alu};
+            t[0xb0 + r] = {&opMovRegImm8, 0, OpClass::Alu};
+            t[0xb8 + r] = {&opMovRegImm16, 0, OpClass::Alu};
+            t[0xd8 + r] = {&opEscape, MODRM, OpClass::System};
+        }
+        t[0x90] = {&opNop, 0, OpClass::Alu};
+        for (uint8_t cc = 0; cc < 16; ++cc) {
+            t[0x70 + cc] = {&opJcc, 0, OpClass::Branch};
+            // The 8086 decodes 60-6F as a second copy of the conditional jumps
+            t[0x60 + cc] = {&opJcc, 0, OpClass::Branch};
+        }
+        t[0x80] = {&opGroup1<0>, MODRM, OpClass::Alu};
+        t[0x81] = {&opGroup1<1>, MODRM, OpClass::Alu};
+        t[0x82] = {&opGroup1<2>, MODRM, OpClass::Alu};
+        t[0x83] = {&opGroup1<3>, MODRM, OpClass::Alu};
+        t[0x84] = {&opTest<false>, MODRM, OpClass::Alu};
+        t[0x85] = {&opTest<true>, MODRM, OpClass::Alu};
+        t[0x86] = {&opXchg<false>, MODRM, OpClass::Alu};
+        t[0x87] = {&opXchg<true>, MODRM, OpClass::Alu};
+        t[0x88] = {&opMovToRm<false>, MODRM, OpClass::Store};
+        t[0x89] = {&opMovToRm<true>, MODRM, OpClass::Store};
+        t[0x8a] = {&opMovFromRm<false>, MODRM, OpClass::Load};
+        t[0x8b] = {&opMovFromRm<true>, MODRM, OpClass::Load};
+        t[0x8c] = {&opMovFromSegment, MODRM, OpClass::Alu};
+        t[0x8d] = {&opLea, MODRM, OpClass::Alu};
+        t[0x8e] = {&opMovToSegment, MODRM, OpClass::Alu};
+        t[0x8f] = {&opPopRm, MODRM, OpClass::Load};
+        t[0x98] = {&opCbw, 0, OpClass::Alu};
+        t[0x99] = {&opCwd, 0, OpClass::Alu};
+        t[0x9a] = {&opFarDirect, 0, OpClass::Jump};
+        t[0x9b] = {&opNop, 0, OpClass::System};
+        t[0x9c] = {&opPushf, 0, OpClass::Store};
+        t[0x9d] = {&opPopf, 0, OpClass::Load};
+        t[0x9e] = {&opSahf, 0, OpClass::Alu};
+        t[0x9f] = {&opLahf, 0, OpClass::Alu};
+        t[0xa0] = {&opMovOffset<false, false>, 0, OpClass::Load};
+        t[0xa1] = {&opMovOffset<true, false>, 0, OpClass::Load};
+        t[0xa2] = {&opMovOffset<false, true>, 0, OpClass::Store};
+        t[0xa3] = {&opMovOffset<true, true>, 0, OpClass::Store};
+        t[0xa4] = {&opString<MOVS, false>, 0, OpClass::Store};
+        t[0xa5] = {&opString<MOVS, true>, 0, OpClass::Store};
+        t[0xa6] = {&opString<CMPS, false>, 0, OpClass::Load};
+        t[0xa7] = {&opString<CMPS, true>, 0, OpClass::Load};
+        t[0xa8] = {&opTestAccumulator<false>, 0, OpClass::Alu};
+        t[0xa9] = {&opTestAccumulator<true>, 0, OpClass::Alu};
+        t[0xaa] = {&opString<STOS, false>, 0, OpClass::Store};
+        t[0xab] = {&opString<STOS, true>, 0, OpClass::Store};
+        t[0xac] = {&opString<LODS, false>, 0, OpClass::Load};
+        t[0xad] = {&opString<LODS, true>, 0, OpClass::Load};
+        t[0xae] = {&opString<SCAS, false>, 0, OpClass::Load};
+        t[0xaf] = {&opString<SCAS, true>, 0, OpClass::Load};
+        t[0xc2] = {&opRet, 0, OpClass::Jump};
+        t[0xc3] = {&opRet, 0, OpClass::Jump};
+        t[0xc4] = {&opLoadFarPointer, MODRM, OpClass::Load};
+        t[0xc5] = {&opLoadFarPointer, MODRM, OpClass::Load};
+        t[0xc6] = {&opMovRmImm<false>, MODRM, OpClass::Store};
+        t[0xc7] = {&opMovRmImm<true>, MODRM, OpClass::Store};
+        t[0xca] = {&opRet, 0, OpClass::Jump};
+        t[0xcb] = {&opRet, 0, OpClass::Jump};
+        // The 8086 decodes C0/C1/C8/C9 as RET/RETF aliases
+        t[0xc0] = t[0xc2];
+        t[0xc1] = t[0xc3];
+        t[0xc8] = t[0xca];
+        t[0xc9] = t[0xcb];
+        t[0xcc] = {&opInt, 0, OpClass::System};
+        t[0xcd] = {&opInt, 0, OpClass::System};
+        t[0xce] = {&opInto, 0, OpClass::System};
+        t[0xcf] = {&opIret, 0, OpClass::Jump};
+        t[0xd0] = {&opGroup2<false, COUNT_ONE>, MODRM, OpClass::Alu};
+        t[0xd1] = {&opGroup2<true, COUNT_ONE>, MODRM, OpClass::Alu};
+        t[0xd2] = {&opGroup2<false, COUNT_CL>, MODRM, OpClass::Alu};
+        t[0xd3] = {&opGroup2<true, COUNT_CL>, MODRM, OpClass::Alu};
+        t[0xd4] = {&opAam, 0, OpClass::Alu};
+        t[0xd5] = {&opAad, 0, OpClass::Alu};
+        t[0xd6] = {&opSalc, 0, OpClass::Alu};
+        t[0xd7] = {&opXlat, 0, OpClass::Load};
+        for (uint8_t op = 0xe0; op <= 0xe3; ++op) {
+            t[op] = {&opLoop, 0, OpClass::Branch};
+        }
+        t[0xe4] = {&opIn, 0, OpClass::System};
+        t[0xe5] = {&opIn, 0, OpClass::System};
+        t[0xe6] = {&opOut, 0, OpClass::System};
+        t[0xe7] = {&opOut, 0, OpClass::System};
+        t[0xe8] = {&opCallNear, 0, OpClass::Jump};
+        t[0xe9] = {&opJmpNear, 0, OpClass::Jump};
+        t[0xea] = {&opFarDirect, 0, OpClass::Jump};
+        t[0xeb] = {&opJmpShort, 0, OpClass::Jump};
+        t[0xec] = {&opIn, 0, OpClass::System};
+        t[0xed] = {&opIn, 0, OpClass::System};
+        t[0xee] = {&opOut, 0, OpClass::System};
+        t[0xef] = {&opOut, 0, OpClass::System};
+        t[0xf0] = {&opLockPrefix, PREFIX, OpClass::System};
+        t[0xf1] = t[0xf0];
+        t[0xf2] = {&opRepPrefix, PREFIX, OpClass::System};
+        t[0xf3] = {&opRepPrefix, PREFIX, OpClass::System};
+        t[0xf4] = {&opHlt, 0, OpClass::System};
+        t[0xf5] = {&opFlagControl, 0, OpClass::Alu};
+        t[0xf6] = {&opGroup3<false>, MODRM, OpClass::Alu};
+        t[0xf7] = {&opGroup3<true>, MODRM, OpClass::Alu};
+        for (uint8_t op = 0xf8; op <= 0xfd; ++op) {
+            t[op] = {&opFlagControl, 0, OpClass::Alu};
+        }
+        t[0xfe] = {&opGroup4, MODRM, OpClass::Alu};
+        t[0xff] = {&opGroup5, MODRM, OpClass::Jump};
+
+        if (has186) {
+            t[0x60] = {&opPusha, 0, OpClass::Store};
+            t[0x61] = {&opPopa, 0, OpClass::Load};
+            t[0x62] = {&opBound, MODRM, OpClass::Load};
+            t[0x68] = {&opPushImm, 0, OpClass::Store};
+            t[0x69] = {&opImul, MODRM, OpClass::Alu};
+            t[0x6a] = {&opPushImm, 0, OpClass::Store};
+            t[0x6b] = {&opImul, MODRM, OpClass::Alu};
+            t[0x6c] = {&opString<INS, false>, 0, OpClass::Store};
+            t[0x6d] = {&opString<INS, true>, 0, OpClass::Store};
+            t[0x6e] = {&opString<OUTS, false>, 0, OpClass::Load};
+            t[0x6f] = {&opString<OUTS, true>, 0, OpClass::Load};
+            for (uint8_t op : {0x63, 0x64, 0x65, 0x66, 0x67, 0xd6, 0xf1}) {
+                t[op] = {&opIllegal, 0, OpClass::System};
+            }
+            t[0xc0] = {&opGroup2<false, COUNT_IMM>, MODRM, OpClass::Alu};
+            t[0xc1] = {&opGroup2<true, COUNT_IMM>, MODRM, OpClass::Alu};
+            t[0xc8] = {&opEnter, 0, OpClass::Store};
+            t[0xc9] = {&opLeave, 0, OpClass::Load};
+        }
+        return t;
+    }
+
+    static const Table& table(bool has186) {
+        static const Table table8086 = buildTable(false);
+        static const Table table80186 = buildTable(true);
+        return has186 ? table80186 : table8086;
+    }
+
+    static void step(Cpu& c) {
+        X86State& s = c.s;
+        const bool singleStep = s.flags & FLAG_TF;
+        c.startIp = s.ip;
+        c.segOverride = -1;
+        c.rep = 0;
+
+        c.opcode = fetch8(c);
+        const Opcode* op = &c.table[c.opcode];
+        for (int prefixes = 0; op->attributes & PREFIX; ++prefixes) {
+            if (prefixes == MAX_PREFIXES) {
+                // Resume the prefix run on the next step so a page of
+                // prefixes cannot stall the quantum
+                return;
+            }
+            op->handler(c);
+            c.opcode = fetch8(c);
+            op = &c.table[c.opcode];
+        }
+        if (op->attributes & MODRM) {
+            decodeModrm(c);
+        }
+        c.vpu.countOpClass(op->opClass);
+        op->handler(c);
+
+        if (singleStep && c.vpu.running) {
+            interrupt(c, 1);
+        }
+    }
+};
+
+X86Core::X86Core(FiscVpu& vpu, bool has186) : vpu(vpu), state{} {
+    state.has186 = has186;
+}
+
+void X86Core::reset(uint64_t entry) {
+    // The entry address splits into a 64 KiB-aligned segment and an offset,
+    // so 0x7c00 enters at 0000:7C00 and 0xffff0 at F000:FFF0
+    const bool has186 = state.has186;
+    state = X86State{};
+    state.has186 = has186;
+    state.segs[X86State::CS] = static_cast<uint16_t>((entry >> 16) << 12);
+    state.segs[X86State::DS] = state.segs[X86State::ES] = state.segs[X86State::SS] = state.segs[X86State::CS];
+    state.ip = static_cast<uint16_t>(entry);
+    state.regs[X86State::SP] = 0xfffe;
+    console.clear();
+    syncProgramCounter();
+}
+
+uint64_t X86Core::run(uint64_t maxInstructions) {
+    X86Ops::Cpu c{*this, vpu, state, vpu.memory.data(),
+                  static_cast<uint32_t>(std::min<size_t>(vpu.memory.size(), REAL_MODE_LIMIT)),
+                  X86Ops::table(state.has186), 0, 0, -1, 0, 0, 0, 0, 0, 0};
+    uint64_t count = 0;
+    while (count < maxInstructions && vpu.running) {
+        X86Ops::step(c);
+        ++count;
+    }
+    syncProgramCounter();
+    return count;
+}
+
+std::vector<uint8_t> X86Core::saveState() const {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+    return std::vector<uint8_t>(bytes, bytes + sizeof(state));
+}
+
+bool X86Core::restoreState(const std::vector<uint8_t>& saved) {
+    if (saved.size() != sizeof(state)) {
+        return false;
+    }
+    std::memcpy(&state, saved.data(), sizeof(state));
+    syncProgramCounter();
+    return true;
+}
+
+void X86Core::syncProgramCounter() {
+    vpu.pc = RealModeBus::wrap((static_cast<uint32_t>(state.segs[X86State::CS]) << 4) + state.ip);
+}
+
+void X86Core::consoleOutput(char ch) {
+    if (ch == '\n') {
+        flushConsole();
+    } else if (ch != '\r') {
+        console.push_back(ch);
+        if (console.size() >= OutputChannel::MAX_MESSAGE) {
+            flushConsole();
+        }
+    }
+}
+
+void X86Core::flushConsole() {
+    if (!console.empty()) {
+        vpu.emitConsole(console);
+        console.clear();
+    }
+}
+
+std::unique_ptr<CpuCore> FiscVpu::createX86Core() {
+    if (!archState.realMode) {
+        emit("Protected mode is not emulated, " + std::string(archState.model->name) + " starts in real mode");
+    }
+    // Everything after the 8086 runs the 80186 instruction set
+    return std::make_unique<X86Core>(*this, std::strcmp(archState.model->name, "8086") != 0);
+}
@@ -0,0 +1,76 @@
+#ifndef GUEST_BUS_HPP
+#define GUEST_BUS_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+enum class ByteOrder : uint8_t {
+    Little,
+    Big
+};
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr ByteOrder HOST_BYTE_ORDER = ByteOrder::Big;
+#else
+constexpr ByteOrder HOST_BYTE_ORDER = ByteOrder::Little;
+#endif
+
+template <typename T>
+inline T byteSwap(T value) {
+    static_assert(std::is_integral<T>::value, "byteSwap needs an integer type");
+    using U = typename std::make_unsigned<T>::type;
+    U bits = static_cast<U>(value);
+#if defined(__GNUC__) || defined(__clang__)
+    if constexpr (sizeof(T) == 2) {
+        bits = __builtin_bswap16(bits);
+    } else if constexpr (sizeof(T) == 4) {
+        bits = __builtin_bswap32(bits);
+    } else if constexpr (sizeof(T) == 8) {
+        bits = __builtin_bswap64(bits);
+    }
+#else
+    U swapped = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        swapped = static_cast<U>((swapped << 8) | ((bits >> (8 * i)) & 0xff));
+    }
+    bits = swapped;
+#endif
+    return static_cast<T>(bits);
+}
+
+// Guest memory accessors for one byte order and address bus width, chosen
+// once per configuration. Accesses in host order are a single unaligned host
+// load or store, and addresses wrap at the bus width with a constant mask.
+// Callers bounds-check the wrapped address against guest RAM.
+template <ByteOrder Order, unsigned AddressBits>
+struct GuestBus {
+    static constexpr ByteOrder ORDER = Order;
+    static constexpr unsigned ADDRESS_BITS = AddressBits;
+    static constexpr uint64_t ADDRESS_MASK = AddressBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << AddressBits) - 1;
+
+    template <typename Address>
+    static constexpr Address wrap(Address address) {
+        return address & static_cast<Address>(ADDRESS_MASK);
+    }
+
+    template <typename T>
+    static T load(const uint8_t* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return Order == HOST_BYTE_ORDER ? value : byteSwap(value);
+    }
+
+    template <typename T>
+    static void store(uint8_t* p, T value) {
+        if (Order != HOST_BYTE_ORDER) {
+            value = byteSwap(value);
+        }
+        std::memcpy(p, &value, sizeof(T));
+    }
+};
+
+// RISC-V instructions are little-endian whatever the data byte order
+using InstructionBus = GuestBus<ByteOrder::Little, 32>;
+
+#endif // GUEST_BUS_HPP
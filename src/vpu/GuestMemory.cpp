@@ -0,0 +1,269 @@
+#include "GuestMemory.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define FISC_GUEST_MMAP 1
+#else
+#define FISC_GUEST_MMAP 0
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#define FISC_GUEST_MEMFD 1
+#else
+#define FISC_GUEST_MEMFD 0
+#endif
+
+GuestMemoryImage::~GuestMemoryImage() {
+#if FISC_GUEST_MEMFD
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+GuestMemory::GuestMemory()
+    : base(nullptr), length(0), mapped(false), hugePages(false), imageFd(-1) {}
+
+GuestMemory::~GuestMemory() {
+    release();
+}
+
+bool GuestMemory::allocate(size_t size, bool useHugePages) {
+    release();
+    if (size == 0) {
+        return false;
+    }
+    
+#if FISC_GUEST_MMAP
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (region != MAP_FAILED) {
+        base = static_cast<uint8_t*>(region);
+        length = size;
+        mapped = true;
+#ifdef MADV_HUGEPAGE
+        if (useHugePages) {
+            hugePages = madvise(region, size, MADV_HUGEPAGE) == 0;
+        }
+#endif
+        return true;
+    }
+#endif
+    
+    // Heap fallback; calloc still hands out lazily zeroed pages on most hosts
+    (void)useHugePages;
+    base = static_cast<uint8_t*>(std::calloc(size, 1));
+    if (!base) {
+        return false;
+    }
+    length = size;
+    return true;
+}
+
+void GuestMemory::release() {
+    if (!base) {
+        return;
+    }
+#if FISC_GUEST_MMAP
+    if (mapped) {
+        munmap(base, length);
+    } else {
+        std::free(base);
+    }
+#else
+    std::free(base);
+#endif
+#if FISC_GUEST_MEMFD
+    if (imageFd >= 0) {
+        close(imageFd);
+    }
+#endif
+    base = nullptr;
+    length = 0;
+    mapped = false;
+    hugePages = false;
+    imageFd = -1;
+    fileRanges.clear();
+}
+
+namespace {
+
+bool allZero(const uint8_t* bytes, size_t size) {
+    // A region is zero if its first byte is and it equals itself shifted by one
+    return size == 0 || (bytes[0] == 0 && std::memcmp(bytes, bytes + 1, size - 1) == 0);
+}
+
+} // namespace
+
+#if FISC_GUEST_MEMFD
+// One flag per host page, set where the page may hold data. Pages are
+// found without touching them: the kernel's page table entries give the
+// anonymous pages written so far (present or swapped out), and the backing
+// image and files give the ones the guest has not faulted in yet.
+std::vector<uint8_t> GuestMemory::populatedPages() const {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t pages = (length + pageSize - 1) / pageSize;
+    std::vector<uint8_t> populated(pages, 1);
+    int pagemap = mapped ? open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC) : -1;
+    if (pagemap < 0) {
+        return populated;  // Every page is read
+    }
+    
+    constexpr uint64_t PAGE_PRESENT = 1ull << 63;
+    constexpr uint64_t PAGE_SWAPPED = 1ull << 62;
+    const off_t first = static_cast<off_t>(reinterpret_cast<uintptr_t>(base) / pageSize * sizeof(uint64_t));
+    std::vector<uint64_t> entries(4096);
+    for (size_t page = 0; page < pages; page += entries.size()) {
+        const size_t count = std::min(entries.size(), pages - page);
+        const ssize_t bytes = static_cast<ssize_t>(count * sizeof(uint64_t));
+        if (pread(pagemap, entries.data(), bytes, first + static_cast<off_t>(page * sizeof(uint64_t))) != bytes) {
+            close(pagemap);
+            std::fill(populated.begin(), populated.end(), 1);
+            return populated;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            populated[page + i] = (entries[i] & (PAGE_PRESENT | PAGE_SWAPPED)) != 0;
+        }
+    }
+    close(pagemap);
+    
+    if (imageFd >= 0) {
+        const off_t end = static_cast<off_t>(length);
+        for (off_t data = lseek(imageFd, 0, SEEK_DATA); data >= 0 && data < end;
+             data = lseek(imageFd, data, SEEK_DATA)) {
+            off_t hole = lseek(imageFd, data, SEEK_HOLE);
+            if (hole < 0) {
+                hole = end;
+            }
+            std::fill(populated.begin() + data / pageSize,
+                      populated.begin() + std::min<size_t>(pages, (hole + pageSize - 1) / pageSize), 1);
+            data = hole;
+        }
+    }
+    for (const auto& range : fileRanges) {
+        std::fill(populated.begin() + range.first / pageSize,
+                  populated.begin() + (range.first + range.second + pageSize - 1) / pageSize, 1);
+    }
+    return populated;
+}
+#endif
+
+std::shared_ptr<const GuestMemoryImage> GuestMemory::capture() const {
+    std::shared_ptr<GuestMemoryImage> image(new GuestMemoryImage());
+    image->length = length;
+    
+#if FISC_GUEST_MEMFD
+    int fd = memfd_create("fisc-snapshot", MFD_CLOEXEC);
+    if (fd >= 0 && ftruncate(fd, static_cast<off_t>(length)) == 0) {
+        // Only populated pages are read, so a snapshot costs what the guest
+        // uses rather than MEMORY_SIZE; those that are all zero stay holes
+        // in the file as well
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t pages = (length + pageSize - 1) / pageSize;
+        const std::vector<uint8_t> populated = populatedPages();
+        auto zeroPage = [&](size_t page) {
+            size_t offset = page * pageSize;
+            return !populated[page] || allZero(base + offset, std::min(pageSize, length - offset));
+        };
+        bool ok = true;
+        for (size_t page = 0; page < pages && ok; ++page) {
+            if (zeroPage(page)) {
+                continue;
+            }
+            size_t run = 1;
+            while (page + run < pages && !zeroPage(page + run)) {
+                ++run;
+            }
+            size_t offset = page * pageSize;
+            size_t bytes = std::min(run * pageSize, length - offset);
+            ok = pwrite(fd, base + offset, bytes, static_cast<off_t>(offset)) == static_cast<ssize_t>(bytes);
+            page += run;  // The page after the run is zero or past the end
+        }
+        if (ok) {
+            image->fd = fd;
+            return image;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+    
+    image->copy.assign(base, base + length);
+    return image;
+}
+
+bool GuestMemory::mapImage(const GuestMemoryImage& image) {
+#if FISC_GUEST_MEMFD
+    if (image.fd >= 0) {
+        release();
+        void* region = mmap(nullptr, image.length, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_NORESERVE, image.fd, 0);
+        if (region == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<uint8_t*>(region);
+        length = image.length;
+        mapped = true;
+        imageFd = fcntl(image.fd, F_DUPFD_CLOEXEC, 0);
+        return true;
+    }
+#endif
+    if (!allocate(image.length, false)) {
+        return false;
+    }
+    std::memcpy(base, image.copy.data(), image.length);
+    return true;
+}
+
+bool GuestMemory::mapFile(int fd, uint64_t fileOffset, size_t offset, size_t size) {
+#if FISC_GUEST_MMAP
+    if (!mapped || offset + size > length) {
+        return false;
+    }
+    void* region = mmap(base + offset, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                        fd, static_cast<off_t>(fileOffset));
+    if (region == MAP_FAILED) {
+        return false;
+    }
+    fileRanges.emplace_back(offset, size);
+    return true;
+#else
+    (void)fd;
+    (void)fileOffset;
+    (void)offset;
+    (void)size;
+    return false;
+#endif
+}
+
+size_t GuestMemory::residentBytes() const {
+#if FISC_GUEST_MMAP
+    if (mapped) {
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t pages = (length + pageSize - 1) / pageSize;
+#ifdef __APPLE__
+        std::vector<char> residency(pages);
+#else
+        std::vector<unsigned char> residency(pages);
+#endif
+        if (mincore(base, length, residency.data()) == 0) {
+            size_t resident = 0;
+            for (auto page : residency) {
+                resident += page & 1;
+            }
+            return resident * pageSize;
+        }
+    }
+#endif
+    return length;
+}
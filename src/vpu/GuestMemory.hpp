@@ -0,0 +1,79 @@
+#ifndef GUEST_MEMORY_HPP
+#define GUEST_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class GuestMemory;
+
+// Immutable copy of guest RAM. On Linux it lives in a memfd that every
+// fork maps MAP_PRIVATE, so forks share pages until they write them.
+class GuestMemoryImage {
+public:
+    ~GuestMemoryImage();
+    GuestMemoryImage(const GuestMemoryImage&) = delete;
+    GuestMemoryImage& operator=(const GuestMemoryImage&) = delete;
+    
+    size_t size() const { return length; }
+
+private:
+    friend class GuestMemory;
+    GuestMemoryImage() : fd(-1), length(0) {}
+    
+    int fd;
+    size_t length;
+    std::vector<uint8_t> copy;  // Used where the host cannot share pages
+};
+
+// Guest RAM reserved up front and populated by the host on first touch, so
+// a large guest only costs the pages it actually uses. On Linux the region
+// can additionally be advised for transparent huge pages.
+class GuestMemory {
+public:
+    GuestMemory();
+    ~GuestMemory();
+    GuestMemory(const GuestMemory&) = delete;
+    GuestMemory& operator=(const GuestMemory&) = delete;
+    
+    // Replaces any previous mapping with a fresh zero-filled region
+    bool allocate(size_t size, bool hugePages);
+    void release();
+    
+    // Copy-on-write snapshot support: capture() writes the populated pages
+    // into a new image without faulting in the rest, mapImage() makes this
+    // memory a private view of it
+    std::shared_ptr<const GuestMemoryImage> capture() const;
+    bool mapImage(const GuestMemoryImage& image);
+    
+    // Maps file pages privately over [offset, offset + length); both offsets
+    // must be host page aligned. False where the host cannot map files.
+    bool mapFile(int fd, uint64_t fileOffset, size_t offset, size_t length);
+    
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    uint8_t& operator[](size_t offset) { return base[offset]; }
+    const uint8_t& operator[](size_t offset) const { return base[offset]; }
+    
+    bool usesHugePages() const { return hugePages; }
+    
+    // Host memory actually backing the guest right now
+    size_t residentBytes() const;
+
+private:
+    uint8_t* base;
+    size_t length;
+    bool mapped;     // Obtained from mmap rather than the heap fallback
+    bool hugePages;
+    
+    // Where content can live in pages that were never touched: the image a
+    // fork maps (a duplicate of its descriptor) and ranges mapped from files
+    int imageFd;
+    std::vector<std::pair<size_t, size_t>> fileRanges;  // Offset, length
+    std::vector<uint8_t> populatedPages() const;
+};
+
+#endif // GUEST_MEMORY_HPP
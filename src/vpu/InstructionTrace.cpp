@@ -0,0 +1,189 @@
+#include "InstructionTrace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef FISC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+InstructionTrace::InstructionTrace()
+    : ring(new TraceRecord[RING_SIZE]), produceTail(0), cachedHead(0),
+      tail(0), head(0), written(0), stopping(false), writeFailed(false), file(nullptr), gzFile(nullptr) {
+}
+
+InstructionTrace::~InstructionTrace() {
+    close();
+}
+
+bool InstructionTrace::close() {
+    if (writer.joinable()) {
+        publish();
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        wakeCv.notify_one();
+        writer.join();
+    }
+#ifdef FISC_HAVE_ZLIB
+    if (gzFile) {
+        if (gzclose(static_cast<::gzFile>(gzFile)) != Z_OK) {
+            writeFailed = true;
+        }
+        gzFile = nullptr;
+    }
+#endif
+    if (file) {
+        if (std::fclose(file) != 0) {
+            writeFailed = true;
+        }
+        file = nullptr;
+    }
+    return !writeFailed;
+}
+
+bool InstructionTrace::compressionAvailable() {
+#ifdef FISC_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool InstructionTrace::open(const std::string& path, bool compress, bool append, std::string& error) {
+    bool empty = true;
+    if (append) {
+        std::FILE* existing = std::fopen(path.c_str(), "rb");
+        if (existing) {
+            empty = std::fgetc(existing) == EOF;
+            std::fclose(existing);
+        }
+    }
+    
+#ifdef FISC_HAVE_ZLIB
+    if (compress) {
+        // An appended gzip member still reads back as one stream
+        gzFile = gzopen(path.c_str(), append ? "ab1" : "wb1");
+        if (!gzFile) {
+            error = "cannot create trace file " + path;
+            return false;
+        }
+    }
+#else
+    (void)compress;
+#endif
+    if (!gzFile) {
+        file = std::fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) {
+            error = "cannot create trace file " + path;
+            return false;
+        }
+    }
+
+    if (empty) {
+        TraceFileHeader header{};
+        std::memcpy(header.magic, "FISCTRC1", sizeof(header.magic));
+        header.recordSize = sizeof(TraceRecord);
+        if (!writeBytes(&header, sizeof(header))) {
+            error = "cannot write trace file " + path;
+            return false;
+        }
+    }
+
+    writer = std::thread([this]() {
+        writerLoop();
+    });
+    return true;
+}
+
+void InstructionTrace::publish() {
+    tail.store(produceTail, std::memory_order_release);
+
+    // The writer polls on its own; only wake it when the backlog builds up
+    if (produceTail - cachedHead >= RING_SIZE / 2) {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (produceTail - cachedHead >= RING_SIZE / 2) {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+            }
+            wakeCv.notify_one();
+        }
+    }
+}
+
+void InstructionTrace::waitForSpace() {
+    publish();
+    while (true) {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (produceTail - cachedHead < RING_SIZE) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void InstructionTrace::writerLoop() {
+    uint64_t unflushed = 0;
+    int idleWaits = 0;
+    while (true) {
+        uint64_t begin = head.load(std::memory_order_relaxed);
+        uint64_t end = tail.load(std::memory_order_acquire);
+
+        if (begin == end) {
+            if (stopping) {
+                break;
+            }
+            if (unflushed && ++idleWaits >= IDLE_FLUSH_WAITS) {
+                if (!flushFile()) {
+                    writeFailed = true;
+                }
+                unflushed = 0;
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait_for(lock, std::chrono::milliseconds(2));
+            continue;
+        }
+        idleWaits = 0;
+
+        // Write the contiguous run up to the end of the ring in one go. After
+        // a failed write the ring is still drained so the VPU never stalls.
+        size_t offset = begin & (RING_SIZE - 1);
+        size_t count = std::min<uint64_t>(end - begin, RING_SIZE - offset);
+        if (!writeFailed) {
+            if (!writeBytes(&ring[offset], count * sizeof(TraceRecord))) {
+                writeFailed = true;
+            } else {
+                written.fetch_add(count, std::memory_order_relaxed);
+            }
+            unflushed += count * sizeof(TraceRecord);
+            if (unflushed >= FLUSH_INTERVAL) {
+                if (!flushFile()) {
+                    writeFailed = true;
+                }
+                unflushed = 0;
+            }
+        }
+        head.store(begin + count, std::memory_order_release);
+    }
+    // close() flushes as it closes the file
+}
+
+bool InstructionTrace::writeBytes(const void* data, size_t size) {
+#ifdef FISC_HAVE_ZLIB
+    if (gzFile) {
+        return gzwrite(static_cast<::gzFile>(gzFile), data, static_cast<unsigned>(size)) ==
+               static_cast<int>(size);
+    }
+#endif
+    return std::fwrite(data, 1, size, file) == size;
+}
+
+bool InstructionTrace::flushFile() {
+#ifdef FISC_HAVE_ZLIB
+    if (gzFile) {
+        return gzflush(static_cast<::gzFile>(gzFile), Z_SYNC_FLUSH) == Z_OK;
+    }
+#endif
+    return std::fflush(file) == 0;
+}
@@ -0,0 +1,111 @@
+#ifndef INSTRUCTION_TRACE_HPP
+#define INSTRUCTION_TRACE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// On-disk trace format: a TraceFileHeader followed by fixed-size records.
+// Compressed traces are the same stream wrapped in gzip.
+struct TraceFileHeader {
+    char magic[8];        // "FISCTRC1"
+    uint32_t recordSize;  // sizeof(TraceRecord)
+    uint32_t reserved;
+};
+
+struct TraceRecord {
+    uint32_t pc;
+    uint32_t instruction;  // Raw encoding
+    uint32_t rdValue;      // Destination register after execution
+    uint32_t memAddress;   // Effective address of a load or store
+    uint8_t rd;            // 0 when the instruction writes no register
+    uint8_t memSize;       // Access width in bytes, 0 for non-memory instructions
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+enum TraceFlags : uint8_t {
+    TRACE_STORE = 1 << 0,
+    TRACE_TRAP = 1 << 1   // Instruction did not complete
+};
+
+static_assert(sizeof(TraceRecord) == 20, "trace records are written verbatim");
+
+// Per-VPU trace sink. The VPU thread fills records straight into a
+// single-producer/single-consumer ring and publishes them once per batch;
+// a background thread drains the ring to the trace file.
+class InstructionTrace {
+public:
+    InstructionTrace();
+    ~InstructionTrace();
+    InstructionTrace(const InstructionTrace&) = delete;
+    InstructionTrace& operator=(const InstructionTrace&) = delete;
+
+    // compress is honoured only when built with zlib. append continues an
+    // existing trace instead of truncating it: records follow the ones
+    // already there, and the header is written only to an empty file.
+    bool open(const std::string& path, bool compress, bool append, std::string& error);
+    static bool compressionAvailable();
+    
+    // Drains the ring and closes the file. False if any part of the trace
+    // could not be written; the destructor closes without reporting.
+    bool close();
+
+    // Producer side, VPU thread only. Blocks while the ring is full.
+    TraceRecord& nextRecord() {
+        if (produceTail - cachedHead == RING_SIZE) {
+            waitForSpace();
+        }
+        return ring[produceTail & (RING_SIZE - 1)];
+    }
+    void commitRecord() {
+        if (((++produceTail) & (PUBLISH_BATCH - 1)) == 0) {
+            publish();
+        }
+    }
+    void publish();
+
+    uint64_t recordsWritten() const { return written.load(std::memory_order_relaxed); }
+
+    static constexpr size_t RING_SIZE = 1 << 16;  // Records, power of two
+
+private:
+    static constexpr size_t PUBLISH_BATCH = 256;
+    // The writer flushes the file after this many bytes (a gzip sync flush
+    // costs compression ratio and time) or once the ring has stayed empty
+    // for IDLE_FLUSH_WAITS polls, i.e. the VPU paused or stopped
+    static constexpr uint64_t FLUSH_INTERVAL = 8 << 20;
+    static constexpr int IDLE_FLUSH_WAITS = 50;
+
+    std::unique_ptr<TraceRecord[]> ring;
+
+    // Producer-owned
+    alignas(64) uint64_t produceTail;
+    uint64_t cachedHead;
+
+    // Shared indices, each on its own cache line
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint64_t> head;
+
+    alignas(64) std::atomic<uint64_t> written;
+    std::atomic<bool> stopping;
+    std::atomic<bool> writeFailed;  // Latched by the writer, reported by close()
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    std::thread writer;
+
+    std::FILE* file;
+    void* gzFile;  // gzFile when compressing
+
+    void waitForSpace();
+    void writerLoop();
+    bool writeBytes(const void* data, size_t size);
+    bool flushFile();
+};
+
+#endif // INSTRUCTION_TRACE_HPP
@@ -0,0 +1,162 @@
+#include "Mmu.hpp"
+
+namespace {
+
+// PTE bits shared by Sv32 and Sv39
+constexpr uint64_t PTE_V = 1 << 0;
+constexpr uint64_t PTE_R = 1 << 1;
+constexpr uint64_t PTE_W = 1 << 2;
+constexpr uint64_t PTE_X = 1 << 3;
+constexpr uint64_t PTE_A = 1 << 6;
+constexpr uint64_t PTE_D = 1 << 7;
+
+struct Sv32Levels {
+    static constexpr int LEVELS = 2;
+    static constexpr int VPN_BITS = 10;
+    static constexpr size_t PTE_SIZE = 4;
+    static constexpr uint64_t PTE_PPN_MASK = (1ull << 22) - 1;
+    static constexpr uint64_t SATP_PPN_MASK = (1ull << 22) - 1;
+    static bool canonical(uint64_t vaddr) { return vaddr >> 32 == 0; }
+};
+
+struct Sv39Levels {
+    static constexpr int LEVELS = 3;
+    static constexpr int VPN_BITS = 9;
+    static constexpr size_t PTE_SIZE = 8;
+    static constexpr uint64_t PTE_PPN_MASK = (1ull << 44) - 1;
+    static constexpr uint64_t SATP_PPN_MASK = (1ull << 44) - 1;
+    // Bits 63:39 must all equal bit 38
+    static bool canonical(uint64_t vaddr) {
+        return static_cast<uint64_t>(static_cast<int64_t>(vaddr << 25) >> 25) == vaddr;
+    }
+};
+
+} // namespace
+
+Mmu::Mmu(GuestMemory& memory, Format format)
+    : memory(memory), format(format), satp(0), enabled(false), stats{} {
+    flush();
+}
+
+void Mmu::setSatp(uint64_t value) {
+    bool paging;
+    if (format == Format::Sv32) {
+        value &= 0xffffffffull;
+        paging = (value >> 31) != 0;
+    } else {
+        uint64_t mode = value >> 60;
+        if (mode != 0 && mode != 8) {
+            return;
+        }
+        paging = mode == 8;
+    }
+    satp = value;
+    enabled = paging;
+    flush();
+}
+
+void Mmu::flush() {
+    for (auto& entry : fetchTlb) {
+        entry = TlbEntry{INVALID_TAG, 0};
+    }
+    for (auto& entry : dataTlb) {
+        entry = DataTlbEntry{INVALID_TAG, INVALID_TAG, 0};
+    }
+}
+
+void Mmu::flushPage(uint64_t vaddr) {
+    const uint64_t page = vaddr & ~PAGE_MASK;
+    const size_t index = (vaddr >> PAGE_SHIFT) & (TLB_ENTRIES - 1);
+    if (fetchTlb[index].tag == page) {
+        fetchTlb[index] = TlbEntry{INVALID_TAG, 0};
+    }
+    if (dataTlb[index].readTag == page || dataTlb[index].writeTag == page) {
+        dataTlb[index] = DataTlbEntry{INVALID_TAG, INVALID_TAG, 0};
+    }
+}
+
+bool Mmu::refill(uint64_t vaddr, Access access, uint64_t& paddr) {
+    if (access == Access::Fetch) {
+        ++stats.fetchMisses;
+    } else {
+        ++stats.dataMisses;
+    }
+
+    const uint64_t page = vaddr & ~PAGE_MASK;
+    uint64_t pageBase = page;
+    bool writable = true;
+    if (enabled) {
+        bool mapped = format == Format::Sv32
+            ? walk<Sv32Levels>(vaddr, access, pageBase, writable)
+            : walk<Sv39Levels>(vaddr, access, pageBase, writable);
+        if (!mapped) {
+            ++stats.pageFaults;
+            return false;
+        }
+    }
+
+    const uint64_t addend = pageBase - page;
+    const size_t index = (vaddr >> PAGE_SHIFT) & (TLB_ENTRIES - 1);
+    if (access == Access::Fetch) {
+        fetchTlb[index] = TlbEntry{page, addend};
+    } else {
+        dataTlb[index] = DataTlbEntry{page, writable ? page : INVALID_TAG, addend};
+    }
+    paddr = vaddr + addend;
+    return true;
+}
+
+template <typename Levels>
+bool Mmu::walk(uint64_t vaddr, Access access, uint64_t& pageBase, bool& writable) {
+    if (!Levels::canonical(vaddr)) {
+        return false;
+    }
+
+    uint64_t table = (satp & Levels::SATP_PPN_MASK) << PAGE_SHIFT;
+    for (int level = Levels::LEVELS - 1; level >= 0; --level) {
+        const uint64_t vpn = (vaddr >> (PAGE_SHIFT + level * Levels::VPN_BITS)) &
+                             ((1ull << Levels::VPN_BITS) - 1);
+        const uint64_t pteAddress = table + vpn * Levels::PTE_SIZE;
+        if (pteAddress + Levels::PTE_SIZE > memory.size()) {
+            return false;
+        }
+        uint8_t* p = &memory[pteAddress];
+        uint64_t pte = 0;
+        for (size_t b = 0; b < Levels::PTE_SIZE; ++b) {
+            pte |= static_cast<uint64_t>(p[b]) << (8 * b);
+        }
+
+        if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W))) {
+            return false;
+        }
+        const uint64_t ppn = (pte >> 10) & Levels::PTE_PPN_MASK;
+        if (!(pte & (PTE_R | PTE_X))) {
+            table = ppn << PAGE_SHIFT;
+            continue;
+        }
+
+        // Leaf: superpages must be aligned to their size
+        const uint64_t superpageBits = static_cast<uint64_t>(level) * Levels::VPN_BITS;
+        if (ppn & ((1ull << superpageBits) - 1)) {
+            return false;
+        }
+        const uint64_t required = access == Access::Fetch ? PTE_X : access == Access::Load ? PTE_R : PTE_W;
+        if (!(pte & required)) {
+            return false;
+        }
+
+        // Hardware A/D update
+        uint64_t updated = pte | PTE_A | (access == Access::Store ? PTE_D : 0);
+        if (updated != pte) {
+            for (size_t b = 0; b < Levels::PTE_SIZE; ++b) {
+                p[b] = static_cast<uint8_t>(updated >> (8 * b));
+            }
+        }
+
+        writable = (updated & PTE_W) && (updated & PTE_D);
+        pageBase = (ppn << PAGE_SHIFT) +
+                   (vaddr & ((1ull << (PAGE_SHIFT + superpageBits)) - 1) & ~PAGE_MASK);
+        return true;
+    }
+    return false;
+}
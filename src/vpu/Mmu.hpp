@@ -0,0 +1,107 @@
+#ifndef MMU_HPP
+#define MMU_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "GuestMemory.hpp"
+
+// RISC-V paging MMU (Sv32, or Sv39 for 64-bit guests) with direct-mapped
+// software TLBs split into fetch and data. A hit costs one tag compare
+// and an add; misses walk the page tables in guest memory and refill the
+// entry. With satp in Bare mode the TLBs are filled with identity
+// mappings, so callers always take the same path.
+//
+// All guest code runs at one privilege level: the U bit is not checked.
+class Mmu {
+public:
+    enum class Format {
+        Sv32,
+        Sv39
+    };
+
+    struct Stats {
+        uint64_t fetchMisses;
+        uint64_t dataMisses;
+        uint64_t pageFaults;
+    };
+
+    Mmu(GuestMemory& memory, Format format);
+
+    // satp write (the CR3 equivalent); flushes both TLBs. Writes selecting
+    // an unsupported mode are ignored, as the privileged spec requires.
+    void setSatp(uint64_t value);
+    uint64_t getSatp() const { return satp; }
+    bool pagingEnabled() const { return enabled; }
+
+    // SFENCE.VMA with rs1=x0 flushes everything, otherwise one page
+    void flush();
+    void flushPage(uint64_t vaddr);
+
+    // False on a page fault; paddr is valid on success
+    bool translateFetch(uint64_t vaddr, uint64_t& paddr) {
+        const TlbEntry& entry = fetchTlb[(vaddr >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+        if (entry.tag == (vaddr & ~PAGE_MASK)) {
+            paddr = vaddr + entry.addend;
+            return true;
+        }
+        return refill(vaddr, Access::Fetch, paddr);
+    }
+    bool translateLoad(uint64_t vaddr, uint64_t& paddr) {
+        const DataTlbEntry& entry = dataTlb[(vaddr >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+        if (entry.readTag == (vaddr & ~PAGE_MASK)) {
+            paddr = vaddr + entry.addend;
+            return true;
+        }
+        return refill(vaddr, Access::Load, paddr);
+    }
+    bool translateStore(uint64_t vaddr, uint64_t& paddr) {
+        const DataTlbEntry& entry = dataTlb[(vaddr >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+        if (entry.writeTag == (vaddr & ~PAGE_MASK)) {
+            paddr = vaddr + entry.addend;
+            return true;
+        }
+        return refill(vaddr, Access::Store, paddr);
+    }
+
+    const Stats& getStats() const { return stats; }
+
+    static constexpr uint32_t PAGE_SHIFT = 12;
+    static constexpr uint64_t PAGE_SIZE = 1ull << PAGE_SHIFT;
+    static constexpr uint64_t PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr size_t TLB_ENTRIES = 256;
+
+private:
+    enum class Access {
+        Fetch,
+        Load,
+        Store
+    };
+
+    static constexpr uint64_t INVALID_TAG = ~0ull;
+
+    struct TlbEntry {
+        uint64_t tag;     // Virtual page base, INVALID_TAG when empty
+        uint64_t addend;  // Physical minus virtual page base
+    };
+    // A store may only use the entry once the page is writable and dirty
+    struct DataTlbEntry {
+        uint64_t readTag;
+        uint64_t writeTag;
+        uint64_t addend;
+    };
+
+    GuestMemory& memory;
+    Format format;
+    uint64_t satp;
+    bool enabled;
+
+    TlbEntry fetchTlb[TLB_ENTRIES];
+    DataTlbEntry dataTlb[TLB_ENTRIES];
+    Stats stats;
+
+    bool refill(uint64_t vaddr, Access access, uint64_t& paddr);
+    template <typename Levels>
+    bool walk(uint64_t vaddr, Access access, uint64_t& pageBase, bool& writable);
+};
+
+#endif // MMU_HPP
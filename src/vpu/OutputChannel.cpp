@@ -0,0 +1,76 @@
+#include "OutputChannel.hpp"
+#include <algorithm>
+#include <cstring>
+
+OutputChannel::OutputChannel(size_t capacity, Backpressure policy)
+    : backpressure(policy), writeIndex(0), readIndex(0), droppedMessages(0), closed(false) {
+    size_t size = 1;
+    while (size < std::max<size_t>(capacity, 2)) {
+        size <<= 1;
+    }
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+}
+
+bool OutputChannel::push(std::string_view message, const std::atomic<bool>* live) {
+    if (closed.load(std::memory_order_acquire)) {
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Claim a slot: its sequence equals the write index while it is free
+    uint64_t position = writeIndex.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[position & mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence - position);
+        if (difference == 0) {
+            if (writeIndex.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Queue full
+            auto stopped = [&]() {
+                return closed.load(std::memory_order_acquire) || (live && !live->load(std::memory_order_acquire));
+            };
+            if (backpressure == Backpressure::Drop || stopped()) {
+                droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // Rechecked under the lock that wake() takes, so a drain between
+            // the check and the wait cannot be missed
+            std::unique_lock<std::mutex> lock(spaceMutex);
+            spaceCv.wait(lock, [&]() {
+                return stopped() ||
+                       static_cast<int64_t>(slot->sequence.load(std::memory_order_acquire) - position) >= 0;
+            });
+            position = writeIndex.load(std::memory_order_relaxed);
+        } else {
+            position = writeIndex.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->length = static_cast<uint32_t>(std::min(message.size(), MAX_MESSAGE));
+    std::memcpy(slot->text, message.data(), slot->length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void OutputChannel::wake() {
+    // Taking the lock orders this against a producer between its check and its wait
+    { std::lock_guard<std::mutex> lock(spaceMutex); }
+    spaceCv.notify_all();
+}
+
+void OutputChannel::close() {
+    closed.store(true, std::memory_order_release);
+    wake();
+}
+
+bool OutputChannel::empty() const {
+    return slots[readIndex & mask].sequence.load(std::memory_order_acquire) != readIndex + 1;
+}
@@ -0,0 +1,83 @@
+#ifndef OUTPUT_CHANNEL_HPP
+#define OUTPUT_CHANNEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+// Bounded lock-free queue carrying VPU output to a front end. Messages are
+// copied into a fixed pool of slots, so pushing never allocates; the front
+// end drains them in batches on its own thread. Any number of VPU threads
+// may push, one thread drains.
+class OutputChannel {
+public:
+    enum class Backpressure {
+        Drop,   // A full queue discards the message and counts it
+        Block   // A full queue makes the producer wait for the consumer
+    };
+
+    static constexpr size_t MAX_MESSAGE = 240;  // Longer messages are truncated
+
+    // capacity is rounded up to a power of two
+    explicit OutputChannel(size_t capacity = 256, Backpressure policy = Backpressure::Drop);
+    OutputChannel(const OutputChannel&) = delete;
+    OutputChannel& operator=(const OutputChannel&) = delete;
+
+    // False if the message was dropped. A producer blocked on a full queue
+    // gives up once the channel is closed or *live turns false; whoever
+    // clears live calls wake() so the producer notices.
+    bool push(std::string_view message, const std::atomic<bool>* live = nullptr);
+    void wake();
+    void close();  // Later pushes are dropped
+
+    // Hands up to maxMessages queued messages to consume, oldest first.
+    // Views are only valid for the duration of the call.
+    template <typename Consumer>
+    size_t drain(Consumer&& consume, size_t maxMessages = SIZE_MAX) {
+        size_t count = 0;
+        while (count < maxMessages) {
+            Slot& slot = slots[readIndex & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != readIndex + 1) {
+                break;
+            }
+            consume(std::string_view(slot.text, slot.length));
+            slot.sequence.store(readIndex + mask + 1, std::memory_order_release);
+            ++readIndex;
+            ++count;
+        }
+        if (count && backpressure == Backpressure::Block) {
+            wake();
+        }
+        return count;
+    }
+
+    bool empty() const;
+    uint64_t dropped() const { return droppedMessages.load(std::memory_order_relaxed); }
+    Backpressure policy() const { return backpressure; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        uint32_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    Backpressure backpressure;
+
+    alignas(64) std::atomic<uint64_t> writeIndex;
+    alignas(64) uint64_t readIndex;  // Consumer-owned
+    alignas(64) std::atomic<uint64_t> droppedMessages;
+
+    // Blocked producers sleep here until drain() frees slots
+    std::atomic<bool> closed;
+    std::mutex spaceMutex;
+    std::condition_variable spaceCv;
+};
+
+#endif // OUTPUT_CHANNEL_HPP
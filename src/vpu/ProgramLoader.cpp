@@ -0,0 +1,223 @@
+#include "ProgramLoader.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FISC_LOADER_MMAP 1
+#else
+#define FISC_LOADER_MMAP 0
+#endif
+
+namespace {
+
+// Read-only view of the whole image file
+class ImageFile {
+public:
+    ~ImageFile() {
+#if FISC_LOADER_MMAP
+        if (view && view != MAP_FAILED) {
+            munmap(view, length);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+    
+    bool open(const std::string& path) {
+#if FISC_LOADER_MMAP
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) {
+            return true;
+        }
+        view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(view);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = reinterpret_cast<const uint8_t*>(buffer.data());
+        length = buffer.size();
+        return true;
+#endif
+    }
+    
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    int descriptor() const { return fd; }
+
+private:
+    int fd = -1;
+    void* view = nullptr;
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    std::vector<char> buffer;
+};
+
+uint64_t readLe(const uint8_t* p, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Places file bytes at a guest offset, mapping whole host pages from the
+// file where the file offset and guest offset are congruent
+void placeSegment(const ImageFile& file, GuestMemory& memory, uint64_t fileOffset,
+                  uint64_t guestOffset, size_t length, bool allowMapping,
+                  ProgramLoader::LoadedProgram& program) {
+    size_t mapStart = 0;
+    size_t mapEnd = 0;
+#if FISC_LOADER_MMAP
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    if (allowMapping && file.descriptor() >= 0 && (fileOffset % pageSize) == (guestOffset % pageSize)) {
+        uint64_t firstPage = (guestOffset + pageSize - 1) / pageSize * pageSize;
+        uint64_t lastPage = (guestOffset + length) / pageSize * pageSize;
+        if (lastPage > firstPage &&
+            memory.mapFile(file.descriptor(), fileOffset + (firstPage - guestOffset),
+                           firstPage, lastPage - firstPage)) {
+            mapStart = firstPage - guestOffset;
+            mapEnd = lastPage - guestOffset;
+        }
+    }
+#else
+    (void)allowMapping;
+#endif
+    
+    // Partial pages around the mapped range are copied
+    std::memcpy(memory.data() + guestOffset, file.data() + fileOffset, mapStart);
+    std::memcpy(memory.data() + guestOffset + mapEnd, file.data() + fileOffset + mapEnd, length - mapEnd);
+    program.mappedBytes += mapEnd - mapStart;
+    program.copiedBytes += length - (mapEnd - mapStart);
+}
+
+bool loadElf(const ImageFile& file, GuestMemory& memory, uint16_t machine, unsigned bits,
+             ProgramLoader::LoadedProgram& program, std::string& error) {
+    const uint8_t* image = file.data();
+    const bool is64 = image[4] == 2;
+    if (image[4] != 1 && image[4] != 2) {
+        error = "unsupported ELF class";
+        return false;
+    }
+    if (image[5] != 1) {
+        error = "only little-endian ELF images are supported";
+        return false;
+    }
+    
+    const size_t headerSize = is64 ? 64 : 52;
+    if (file.size() < headerSize) {
+        error = "truncated ELF header";
+        return false;
+    }
+    const uint64_t imageMachine = readLe(image + 18, 2);
+    if (machine == 0 || imageMachine != machine) {
+        error = "ELF machine " + std::to_string(imageMachine) + " does not match the configured architecture";
+        return false;
+    }
+    // EM_RISCV covers RV32 and RV64 alike; the class tells them apart
+    if ((is64 ? 64u : 32u) != bits) {
+        error = std::string(is64 ? "ELF64" : "ELF32") + " image does not match the configured architecture";
+        return false;
+    }
+    
+    // Bounds are checked by subtraction: header fields are untrusted and
+    // their sums can wrap
+    const size_t word = is64 ? 8 : 4;
+    const uint64_t entry = readLe(image + 24, word);
+    if (entry >= memory.size()) {
+        error = "entry point outside guest memory";
+        return false;
+    }
+    const uint64_t phoff = readLe(image + 24 + word, word);
+    const size_t phentsize = readLe(image + (is64 ? 54 : 42), 2);
+    const size_t phnum = readLe(image + (is64 ? 56 : 44), 2);
+    if (phnum && phentsize < (is64 ? 56 : 32)) {
+        error = "program header entries too small";
+        return false;
+    }
+    if (phoff > file.size() || phentsize * phnum > file.size() - phoff) {
+        error = "truncated program header table";
+        return false;
+    }
+    
+    for (size_t i = 0; i < phnum; ++i) {
+        const uint8_t* ph = image + phoff + i * phentsize;
+        if (readLe(ph, 4) != 1) {  // PT_LOAD
+            continue;
+        }
+        uint32_t flags;
+        uint64_t offset, vaddr, filesz, memsz;
+        if (is64) {
+            flags = static_cast<uint32_t>(readLe(ph + 4, 4));
+            offset = readLe(ph + 8, 8);
+            vaddr = readLe(ph + 16, 8);
+            filesz = readLe(ph + 32, 8);
+            memsz = readLe(ph + 40, 8);
+        } else {
+            offset = readLe(ph + 4, 4);
+            vaddr = readLe(ph + 8, 4);
+            filesz = readLe(ph + 16, 4);
+            memsz = readLe(ph + 20, 4);
+            flags = static_cast<uint32_t>(readLe(ph + 24, 4));
+        }
+        
+        if (filesz > memsz || offset > file.size() || filesz > file.size() - offset) {
+            error = "malformed program segment " + std::to_string(i);
+            return false;
+        }
+        if (vaddr > memory.size() || memsz > memory.size() - vaddr) {
+            error = "segment " + std::to_string(i) + " does not fit in guest memory";
+            return false;
+        }
+        // The .bss tail is already zero in freshly reserved guest memory
+        const bool writable = (flags & 0x2) != 0;
+        placeSegment(file, memory, offset, vaddr, static_cast<size_t>(filesz), !writable, program);
+    }
+    
+    program.isElf = true;
+    program.entry = entry;
+    return true;
+}
+
+} // namespace
+
+bool ProgramLoader::load(const std::string& path, GuestMemory& memory, uint64_t rawLoadAddress,
+                         uint16_t elfMachine, unsigned elfBits, LoadedProgram& program, std::string& error) {
+    program = LoadedProgram{false, rawLoadAddress, 0, 0};
+    
+    ImageFile file;
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    
+    if (file.size() >= 16 && std::memcmp(file.data(), "\x7F" "ELF", 4) == 0) {
+        return loadElf(file, memory, elfMachine, elfBits, program, error);
+    }
+    
+    if (rawLoadAddress > memory.size() || file.size() > memory.size() - rawLoadAddress) {
+        error = "image does not fit in guest memory";
+        return false;
+    }
+    // Raw images are mapped privately; guest writes stay copy-on-write
+    placeSegment(file, memory, 0, rawLoadAddress, file.size(), true, program);
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef PROGRAM_LOADER_HPP
+#define PROGRAM_LOADER_HPP
+
+#include <cstdint>
+#include <string>
+#include "GuestMemory.hpp"
+
+// Loads ELF32/ELF64 executables or raw binaries into guest memory. Read-only
+// ELF segments (and raw images) are mapped straight from the file where page
+// alignment allows, so large images start instantly and share page cache.
+class ProgramLoader {
+public:
+    struct LoadedProgram {
+        bool isElf;
+        uint64_t entry;
+        size_t mappedBytes;  // Bytes backed directly by the file
+        size_t copiedBytes;
+    };
+    
+    // e_machine values of the cores that accept ELF images
+    static constexpr uint16_t ELF_MACHINE_386 = 3;
+    static constexpr uint16_t ELF_MACHINE_RISCV = 243;
+    
+    // Raw binaries are placed at rawLoadAddress and entered there. ELF
+    // images must be built for elfMachine (0 rejects every ELF image) with
+    // the class elfBits names, 32 or 64.
+    static bool load(const std::string& path, GuestMemory& memory, uint64_t rawLoadAddress,
+                     uint16_t elfMachine, unsigned elfBits, LoadedProgram& program, std::string& error);
+};
+
+#endif // PROGRAM_LOADER_HPP
@@ -0,0 +1,208 @@
+#include "VpuPool.hpp"
+#include <algorithm>
+
+VpuPool::VpuPool(size_t workerCount)
+    : activeTasks(0), readyCount(0), stopping(false), nextWorker(0) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers[i]->thread = std::thread([this, i]() {
+            workerLoop(i);
+        });
+    }
+}
+
+VpuPool::~VpuPool() {
+    shutdown();
+}
+
+VpuPool::VpuId VpuPool::submit(std::shared_ptr<FiscVpu> vpu) {
+    Task* task;
+    {
+        // Checked under tasksMutex so shutdown() either sees the task or
+        // the task sees stopping
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push_back(std::make_unique<Task>());
+        task = tasks.back().get();
+        task->id = tasks.size() - 1;
+        task->vpu = std::move(vpu);
+        
+        // No worker is left after shutdown(); both end the task at once
+        if (stopping || !task->vpu->beginScheduledRun()) {
+            task->finished = true;
+            return task->id;
+        }
+        task->resumeAt = FiscVpu::Clock::now();
+        ++activeTasks;
+    }
+
+    Worker& worker = *workers[nextWorker.fetch_add(1) % workers.size()];
+    pushReady(worker, task);
+    return task->id;
+}
+
+VpuPool::Accounting VpuPool::getAccounting(VpuId id) const {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    if (id >= tasks.size()) {
+        return Accounting{};
+    }
+    const Task& task = *tasks[id];
+    return Accounting{
+        task.cpuNanoseconds.load(std::memory_order_relaxed),
+        task.quanta.load(std::memory_order_relaxed),
+        task.instructions.load(std::memory_order_relaxed),
+        task.finished.load()
+    };
+}
+
+size_t VpuPool::vpuCount() const {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    return tasks.size();
+}
+
+void VpuPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(tasksMutex);
+    idleCv.wait(lock, [this]() { return activeTasks == 0; });
+}
+
+void VpuPool::shutdown() {
+    if (stopping.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCv.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // VPUs still queued are stopped in place and count as finished, so
+    // waitIdle() returns
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    for (auto& task : tasks) {
+        if (task->finished) {
+            continue;
+        }
+        if (task->vpu->isRunning()) {
+            task->vpu->stop();
+        }
+        task->finished = true;
+        --activeTasks;
+    }
+    idleCv.notify_all();
+}
+
+void VpuPool::pushReady(Worker& worker, Task* task) {
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.ready.push_back(task);
+    }
+    readyCount.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCv.notify_one();
+}
+
+VpuPool::Task* VpuPool::popLocal(Worker& worker) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    // Promote throttled tasks whose time has come
+    auto now = FiscVpu::Clock::now();
+    for (size_t i = 0; i < worker.waiting.size();) {
+        if (worker.waiting[i]->resumeAt <= now) {
+            worker.ready.push_back(worker.waiting[i]);
+            readyCount.fetch_add(1);
+            worker.waiting[i] = worker.waiting.back();
+            worker.waiting.pop_back();
+        } else {
+            ++i;
+        }
+    }
+
+    if (worker.ready.empty()) {
+        return nullptr;
+    }
+    Task* task = worker.ready.front();
+    worker.ready.pop_front();
+    readyCount.fetch_sub(1);
+    return task;
+}
+
+VpuPool::Task* VpuPool::steal(size_t thief) {
+    for (size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(thief + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ready.empty()) {
+            // Take from the opposite end to the owner
+            Task* task = victim.ready.back();
+            victim.ready.pop_back();
+            readyCount.fetch_sub(1);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void VpuPool::finish(Task* task) {
+    task->finished = true;
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    if (--activeTasks == 0) {
+        idleCv.notify_all();
+    }
+}
+
+void VpuPool::workerLoop(size_t index) {
+    Worker& self = *workers[index];
+
+    while (!stopping) {
+        Task* task = popLocal(self);
+        if (!task) {
+            task = steal(index);
+        }
+
+        if (!task) {
+            // Sleep until new ready work arrives or the next local timer fires
+            FiscVpu::Clock::time_point deadline = FiscVpu::Clock::now() + std::chrono::milliseconds(100);
+            {
+                std::lock_guard<std::mutex> lock(self.mutex);
+                for (Task* waiting : self.waiting) {
+                    deadline = std::min(deadline, waiting->resumeAt);
+                }
+            }
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait_until(lock, deadline, [this]() {
+                return stopping || readyCount > 0;
+            });
+            continue;
+        }
+
+        auto sliceStart = FiscVpu::Clock::now();
+        uint64_t before = task->vpu->getExecutionStats().instructions;
+        task->resumeAt = task->vpu->runSlice();
+        auto sliceEnd = FiscVpu::Clock::now();
+
+        task->cpuNanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(sliceEnd - sliceStart).count(),
+            std::memory_order_relaxed);
+        task->quanta.fetch_add(1, std::memory_order_relaxed);
+        task->instructions.fetch_add(task->vpu->getExecutionStats().instructions - before,
+                                     std::memory_order_relaxed);
+
+        if (!task->vpu->isRunning()) {
+            finish(task);
+        } else if (task->resumeAt > sliceEnd) {
+            std::lock_guard<std::mutex> lock(self.mutex);
+            self.waiting.push_back(task);
+        } else {
+            pushReady(self, task);
+        }
+    }
+}
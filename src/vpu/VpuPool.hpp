@@ -0,0 +1,87 @@
+#ifndef VPU_POOL_HPP
+#define VPU_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FiscVpu.hpp"
+
+// Runs many VPUs on a fixed set of worker threads. Each worker owns a run
+// queue of VPUs and executes them one quantum at a time; idle workers steal
+// runnable VPUs from the others. Throttled VPUs that are ahead of their
+// clock wait on their worker's timer list instead of blocking a thread.
+class VpuPool {
+public:
+    using VpuId = size_t;
+
+    struct Accounting {
+        uint64_t cpuNanoseconds;  // Worker time spent executing this VPU
+        uint64_t quanta;
+        uint64_t instructions;
+        bool finished;
+    };
+
+    // workerCount 0 means one worker per hardware thread
+    explicit VpuPool(size_t workerCount = 0);
+    ~VpuPool();
+    VpuPool(const VpuPool&) = delete;
+    VpuPool& operator=(const VpuPool&) = delete;
+
+    // Takes an initialized VPU and starts scheduling it. After shutdown(),
+    // or if the VPU cannot start, the task is finished at once.
+    VpuId submit(std::shared_ptr<FiscVpu> vpu);
+
+    Accounting getAccounting(VpuId id) const;
+    size_t vpuCount() const;
+    size_t workerCount() const { return workers.size(); }
+
+    // Blocks until every submitted VPU has stopped
+    void waitIdle();
+    // Stops all VPUs and joins the workers
+    void shutdown();
+
+private:
+    struct Task {
+        VpuId id;
+        std::shared_ptr<FiscVpu> vpu;
+        FiscVpu::Clock::time_point resumeAt;
+        std::atomic<uint64_t> cpuNanoseconds{0};
+        std::atomic<uint64_t> quanta{0};
+        std::atomic<uint64_t> instructions{0};
+        std::atomic<bool> finished{false};
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task*> ready;
+        std::vector<Task*> waiting;  // Throttled tasks not yet due
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    mutable std::mutex tasksMutex;
+    std::vector<std::unique_ptr<Task>> tasks;
+    size_t activeTasks;
+    std::condition_variable idleCv;
+
+    // Sleeping workers wait here for new ready work
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    std::atomic<size_t> readyCount;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> nextWorker;
+
+    void workerLoop(size_t index);
+    Task* popLocal(Worker& worker);
+    Task* steal(size_t thief);
+    void pushReady(Worker& worker, Task* task);
+    void finish(Task* task);
+};
+
+#endif // VPU_POOL_HPP
@@ -0,0 +1,43 @@
+#ifndef X86_STATE_HPP
+#define X86_STATE_HPP
+
+#include <cstdint>
+
+// Architectural state of the 8086/80186 real-mode core (FiscVpuX86.cpp).
+// Arithmetic flags are evaluated lazily: flag-setting instructions record
+// their operation, operands and result, and individual flags are derived
+// only when a branch, PUSHF or LAHF asks for them.
+struct X86State {
+    enum Register : uint8_t { AX, CX, DX, BX, SP, BP, SI, DI };
+    enum Segment : uint8_t { ES, CS, SS, DS };
+
+    // Operation behind the lazy flags; None means flags holds them
+    enum class FlagOp : uint8_t {
+        None,
+        Add,
+        Adc,
+        Sub,
+        Sbb,
+        Logic,
+        Inc,   // CF is kept in flags
+        Dec,
+        Shl,
+        Shr,
+        Sar
+    };
+
+    uint16_t regs[8];
+    uint16_t segs[4];
+    uint16_t ip;
+    uint16_t flags;  // CF/PF/AF/ZF/SF/OF are stale while flagOp != None
+
+    FlagOp flagOp;
+    bool flagWide;        // 16-bit operation
+    uint32_t flagResult;  // Unmasked, so carries and borrows survive
+    uint32_t flagDst;
+    uint32_t flagSrc;     // Shift count for shifts
+
+    bool has186;  // 80186 instruction set; later CPUs run as an 80186
+};
+
+#endif // X86_STATE_HPP